@@ -0,0 +1,27 @@
+#pragma once
+#include <string>
+
+// CPU pinning and scheduling priority per thread role, for cabinets where
+// background services cause jitter. Set from the command line:
+//
+//   --affinity sim=2          role=cpu list ("0,2-3"); workers take one CPU
+//   --affinity workers=3-7    each, round robin over the list
+//   --priority sim=fifo:20    SCHED_FIFO at that priority; if not permitted,
+//   --priority main=nice:-5   falls back to nice FALLBACK_NICE
+//
+// Each thread applies its own role when it starts. Anything the OS refuses
+// is reported once per role and the thread carries on with the default
+// scheduling. Linux only; elsewhere the settings are accepted and ignored.
+
+enum ThreadRole {
+    THREAD_MAIN, // Input and render; "input" and "render" name it too
+    THREAD_SIM,
+    THREAD_WORKER,
+    THREAD_ROLE_COUNT
+};
+
+const int FALLBACK_NICE = -10; // For fifo requests without CAP_SYS_NICE
+
+bool parseAffinity(const std::string& arg); // "role=cpus"; false if malformed
+bool parsePriority(const std::string& arg); // "role=fifo:N" or "role=nice:N"
+void applyThreadRole(ThreadRole role, int index = 0); // Call on the thread itself; index picks a worker's CPU
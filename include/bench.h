@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+
+// Headless micro benchmarks of the heavy or contended paths, run with
+// --bench <name>; maxThreads comes from --threads. Each one also checks its
+// results, returning nonzero if a thread count changed the outcome.
+//
+//   erase   circle/trail erasure on stress arenas (long trails, many circles)
+//           at 1, 2, 4 ... maxThreads: ms per call, speedup, result hash
+//   runahead  the per-frame cost of --run-ahead on the same arenas: saving
+//           (copying) the arena, then saving plus N = 1..4 predicted ticks,
+//           against a 60Hz frame; checks each prediction matches stepping
+//           the arena itself and leaves the original untouched
+//   rng     the game's PCG32 streams against std::mt19937: state bytes,
+//           GameState size, snapshot copy cost, draws per second; checks
+//           advance() matches drawing one output at a time
+//   rewind  six seconds of play on the same arenas into a RewindRing: capture
+//           cost on delta and keyframe ticks against a full state copy,
+//           bytes per delta and held, mean and slowest view; checks every
+//           tick views back exactly
+//   checkpoint  a checkpoint of each arena: file size against the state,
+//           encode, decode, submit (the sim thread's copy) and write-to-
+//           rename times; checks it decodes and encodes back to the same
+//           bytes, points stay within 1/512 pixel, and torn or corrupted
+//           files are refused
+//   snapshot  flat snapshots of the same arenas, in MB of trail data a
+//           second: write, open with the hash check, open without it (us),
+//           restore; checks a restored state writes back the same bytes and
+//           that corrupt, short and misaligned buffers are refused
+//   env     VecEnv match ticks per second (steps/s) for a batch of 256 with
+//           random held actions at 1, 2, 4 ... maxThreads; checks every
+//           thread count gives the same observations, rewards and dones
+//   observe occupancy grids of the same arenas: map build (ms), one 2x2
+//           filter pass (us), egocentric grids per head as floats and bytes;
+//           checks the filter against a plain average, the two outputs
+//           agree and a head facing the wall sees it
+//   policy  Policy networks on VecEnv observations (features, and grids):
+//           us per bot over a batch of 512; checks them against the same
+//           weights evaluated in doubles, and that broken files are refused
+//   dataset columnar export of recorded bot matches at 1, 2, 4 ... maxThreads:
+//           rows/s and MB/s; checks the file opens in place, holds every
+//           recorded frame's triggers and is the same at every thread count
+//   queues  SPSC/MPSC stress (every item once, in producer order) and
+//           throughput against a mutex-guarded deque; needs threads
+int runBench(const std::string& name, int maxThreads);
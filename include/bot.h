@@ -0,0 +1,30 @@
+#pragma once
+#include "game.h"
+
+// Steering bot for headless matches. Every think interval it probes a few
+// headings for free space (walls, trails, circles) and leans towards the
+// collectible when the way ahead is clear; between thinks it holds its input.
+// Until its player has moved, going straight presses both triggers equally
+// (no turn), so a bot does not stay immune by never steering.
+//
+// The interval is a next-think time kept here, not a timer on
+// state.scheduler. The scheduler is part of the simulated state (snapshots,
+// checkpoints, rewind, replays), and a bot is a controller outside it like a
+// gamepad: a bot timer there would make a bot match's state differ from the
+// same match played by hand, and a replay of it would not carry the timer.
+class Bot {
+public:
+    explicit Bot(int player, uint64_t thinkIntervalUs = 50000);
+
+    PlayerInput think(const GameState& state, const GameConfig& config); // Call every tick
+    void reset() { nextThinkUs = 0; held = PlayerInput{0, 0}; }
+
+private:
+    float freeDistance(const GameState& state, const Vec2& from, float angle);
+
+    int player;
+    uint64_t interval;
+    uint64_t nextThinkUs;
+    PlayerInput held;
+    CpuCollision probe;
+};
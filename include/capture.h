@@ -0,0 +1,10 @@
+#pragma once
+#include <string>
+
+// Headless screenshots: plays a replay with CPU collision (late for occlusion
+// recordings, see playbackCollision) and the software rasterizer, no window or
+// GL, and writes the last frame to outPath as a PPM.
+// With every > 0, every Nth frame is also written as <outPath stem>-NNNNNN.ppm
+// for capture. Pixel output depends only on the replay, not on the machine
+// or thread count, so it serves as the reference image for renderer checks.
+int runScreenshot(const std::string& replayPath, const std::string& outPath, int every, int threads);
@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "game.h"
+#include "queues.h"
+#ifndef LINES_NO_THREADS
+#include <thread>
+#endif
+
+// Crash-safe checkpoints of a live match, so a cabinet that goes down comes
+// back to the same arena and scores. The whole GameState is written: heads,
+// trails, circles, collectible, scores, RNG streams and pending timers.
+//
+// Layout: magic, version, payload size and an FNV-1a hash of the payload,
+// then the payload. Native byte order, like replays. Trails are the bulk,
+// so they are stored in the order they were laid, as varint deltas:
+// sequence numbers (erasure leaves gaps) and positions in 1/256 pixel
+// fixed point, about 5 bytes a point against 12 in memory. Positions come
+// back within 1/512 pixel; everything else comes back exactly.
+
+const uint32_t CHECKPOINT_MAGIC = 0x4b434e4c; // "LNCK"
+const uint32_t CHECKPOINT_VERSION = 1;
+const uint64_t CHECKPOINT_INTERVAL_US = 1000000; // Simulation time between checkpoints
+
+void encodeCheckpoint(const GameState& state, std::vector<uint8_t>& out); // Replaces out's contents
+// False if the header or hash does not check out, before state is touched.
+// Decodes in place, reusing state's buffers.
+bool decodeCheckpoint(const uint8_t* data, size_t size, GameState& state);
+bool loadCheckpoint(const std::string& path, GameState& state); // False if missing, torn or another version; then call newGame()
+
+// Writes checkpoints off the sim thread. submit() copies the state into a
+// free slot and returns at once; a writer thread encodes it into
+// <path>.tmp, syncs it to disk and renames it over path, so a crash at any
+// point leaves the previous checkpoint or the new one, never a torn file.
+// With both slots busy (a slow disk) a checkpoint is skipped, never waited
+// for. Without threads (LINES_NO_THREADS) submit() writes inline.
+class CheckpointWriter {
+public:
+    explicit CheckpointWriter(const std::string& path);
+    ~CheckpointWriter(); // Finishes what was submitted, then stops the thread
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    bool submit(const GameState& state); // Sim thread; false if both slots were busy and it was skipped
+    // Clean exit, so the next start begins a new match: waits out a write in
+    // progress, then deletes the checkpoint. Later submits are ignored, so
+    // the sim may still be running.
+    void discard();
+    uint64_t written() const { return writtenCount.load(std::memory_order_relaxed); }
+    size_t lastBytes() const { return lastSize.load(std::memory_order_relaxed); }
+
+private:
+    static const int SLOT_COUNT = 2; // One being written, one waiting
+
+    void write(const GameState& state); // Encode, then write, sync and rename
+    void writerLoop();
+
+    std::string path;
+    GameState slots[SLOT_COUNT];
+    SpscQueue<GameState*> ready; // Sim -> writer
+    SpscQueue<GameState*> spare; // Writer -> sim
+    std::vector<uint8_t> buffer; // Writer side, reused
+    std::atomic<bool> stopping;
+    std::atomic<bool> closed; // Set by discard(); no more writes
+    std::atomic<bool> closedSeen; // The writer saw closed with no write in progress
+    std::atomic<uint64_t> writtenCount;
+    std::atomic<size_t> lastSize;
+#ifndef LINES_NO_THREADS
+    std::thread thread;
+#endif
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <cmath>
+#include <string>
+
+// Tuning constants, loaded from a "KEY = value" file (lines.cfg by default).
+// Plain data so it can be copied into the game at a tick boundary without
+// allocating, and written into replay headers.
+struct GameConfig {
+    float playerSpeed = 200.0f; // PLAYER_SPEED, pixels per second
+    float circleSpeed = 300.0f; // CIRCLE_SPEED, pixels per second
+    float turnSpeed = 2.0f * M_PI; // TURN_SPEED, radians per second
+    float circleRadius = 45.0f; // CIRCLE_RADIUS, enemy circle radius
+    float collectibleSize = 90.0f; // COLLECTIBLE_SIZE, green square size
+    float circleSpawnInterval = 5.0f; // CIRCLE_SPAWN_INTERVAL, seconds between yellow circles
+    int gameOverCountdown = 5; // GAME_OVER_COUNTDOWN, seconds on the score screen
+
+    float blackCircleSize() const { return collectibleSize; } // Black circle radius
+    float blackSquareSize() const { return collectibleSize * 5; } // Cleared area around the collectible
+};
+
+const char* const DEFAULT_CONFIG_PATH = "lines.cfg";
+
+// Values not present in the text keep their current value. Unknown keys, bad
+// values and values outside the key's range are reported on stderr and
+// skipped, so a bad hot reload leaves the running value alone.
+bool parseConfig(const std::string& text, GameConfig& config);
+bool loadConfig(const std::string& path, GameConfig& config); // False if the file can't be read
+std::string formatConfig(const GameConfig& config);
+bool setConfigValue(GameConfig& config, const std::string& key, double value); // False for unknown keys, out of range values and fractions for integer keys
+bool configRange(const std::string& key, double& min, double& max); // A key's accepted values; false for unknown keys
+bool configInteger(const std::string& key); // True for keys that only take whole numbers
+
+// Watches the config file for edits (inotify on Linux, mtime polling
+// elsewhere). Call poll() once per tick; it reloads on top of the current
+// values and returns true when they changed.
+class ConfigWatcher {
+public:
+    explicit ConfigWatcher(const std::string& path);
+    ~ConfigWatcher();
+    ConfigWatcher(const ConfigWatcher&) = delete;
+    ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+    bool poll(GameConfig& config);
+
+private:
+    bool changed();
+
+    std::string path;
+    std::string fileName;
+    int inotifyFd;
+    long long lastModified;
+    int pollCounter;
+};
@@ -0,0 +1,108 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Training data for imitation bots, exported from replays of real sessions:
+// one row for every frame a player is alive in a running round, holding
+// where the player was, what VecEnv would have observed for it (env.h), the
+// triggers the player held on that frame and whether it died on it.
+//
+// The file is columnar and meant to be mapped and read in place. Rows come in
+// chunks of at most chunkRows, each chunk holding one replay's rows in frame
+// order, and within a chunk each column is one array starting DATASET_ALIGN
+// bytes in:
+//
+//   DatasetHeader
+//   chunks      per chunk, per column: the chunk's values, then zero padding
+//   directory   DatasetColumn[columnCount], DatasetChunk[chunkCount], then
+//               u64 offsets[chunkCount][columnCount] from the file start
+//
+// Native byte order, as replays are. The header's magic is written last, so a
+// file cut short by a crash is refused rather than read half written.
+//
+// Columns: replay (index in the export's list) and frame (u32), player (u8),
+// dt (f32), sim_time_us (u64), pos_x, pos_y, dir_x, dir_y (f32), score,
+// opponent_score (u32), the ENV_OBS_SIZE observation values one column each
+// (alive, collectible_ahead ... ray_7, f32), left_trigger and right_trigger
+// (i16, 0..32767), died (u8).
+
+const uint32_t DATASET_MAGIC = 0x53444e4c; // "LNDS"
+const uint32_t DATASET_VERSION = 1;
+const uint32_t DATASET_CHUNK_ROWS = 65536;
+const size_t DATASET_ALIGN = 64; // A cache line, so arrays suit SIMD loads
+
+enum DatasetType {
+    DATASET_U8,
+    DATASET_I16,
+    DATASET_U32,
+    DATASET_F32,
+    DATASET_U64
+};
+
+size_t datasetTypeSize(uint32_t type); // 0 for an unknown type
+
+struct DatasetHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t columnCount;
+    uint32_t chunkRows;
+    uint64_t rowCount;
+    uint64_t chunkCount;
+    uint64_t directoryOffset;
+    uint64_t size; // Whole file
+};
+
+struct DatasetColumn {
+    char name[24]; // Zero terminated
+    uint32_t type; // DatasetType
+    uint32_t reserved;
+};
+
+struct DatasetChunk {
+    uint64_t firstRow;
+    uint32_t rows;
+    uint32_t replay;
+};
+
+// A dataset file in memory (read or mapped); nothing is copied. The buffer
+// must outlive the view.
+class DatasetView {
+public:
+    DatasetView() : header(nullptr) {}
+
+    bool open(const uint8_t* data, size_t size); // Checks the header, directory and that every array is in the file
+    bool isOpen() const { return header != nullptr; }
+
+    uint64_t rows() const { return header->rowCount; }
+    size_t chunks() const { return static_cast<size_t>(header->chunkCount); }
+    int columns() const { return static_cast<int>(header->columnCount); }
+    int column(const std::string& name) const; // Index, or -1
+    const DatasetColumn& columnInfo(int index) const { return columnList[index]; }
+    const DatasetChunk& chunk(size_t index) const { return chunkList[index]; }
+    const void* array(size_t chunk, int column) const { return base + offsets[chunk * header->columnCount + column]; } // chunk(chunk).rows values
+
+private:
+    const uint8_t* base;
+    const DatasetHeader* header;
+    const DatasetColumn* columnList;
+    const DatasetChunk* chunkList;
+    const uint64_t* offsets;
+};
+
+struct DatasetStats {
+    int replays = 0; // Exported; unreadable or refused ones are reported and skipped
+    int failed = 0;
+    uint64_t rows = 0;
+    uint64_t bytes = 0;
+};
+
+// Exports replays to outPath. Each replay is streamed a frame at a time by
+// one of threads workers, which hand finished chunks to a shared writer, so
+// memory stays at a chunk per worker however long the corpus; with more
+// than one thread the chunks land in the order they finish.
+bool exportDataset(const std::vector<std::string>& replays, const std::string& outPath, int threads, DatasetStats& stats);
+
+// --export: listPath names the replays, one per line ('#' comments)
+int runExport(const std::string& listPath, const std::string& outPath, int threads);
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "game.h"
+#include "observe.h"
+
+class JobSystem;
+
+// Batched matches for training bots: every match steps one tick in lockstep
+// with both players' actions, and the step reports each player's
+// observation and reward and whether each match's round ended. A round that
+// ends (a death, or maxRoundSeconds) is replaced by a fresh one of the same
+// match before step() returns, skipping the score screen as the sweep does,
+// so the observation after a done is the new round's first.
+//
+// The matches sit in one array and the outputs in flat arrays, match major:
+// observations[(match * 2 + player) * ENV_OBS_SIZE + i], rewards[match * 2 +
+// player], dones[match]. Trails keep their per-tile buffers, reused from
+// round to round, so steady stepping does not allocate. Matches are split
+// across the job system's threads; each is stepped whole on one thread, so
+// results do not depend on the thread count.
+//
+// Observations are egocentric: positions are offsets from the head, turned
+// into its heading (x ahead, y to the right) and divided by the arena width.
+//
+//   0      1 if alive
+//   1-2    collectible offset
+//   3-4    opponent offset
+//   5-6    opponent heading (cos, sin, relative to ours)
+//   7-8    nearest circle offset (0 when there is none)
+//   9-10   nearest circle velocity / circle speed, turned the same way
+//   11-18  free distance along ENV_RAY_ANGLES / ENV_RAY_RANGE (0 to 1)
+//
+// Rewards are zero sum: points scored this step (1 a collectible, 3 for
+// outliving the other player) minus the opponent's.
+//
+// observeGrids() adds the egocentric occupancy grids of observe.h, on
+// demand as they are 4096 values a head: out[(match * 2 + player) *
+// OBS_GRID_CELLS + i].
+
+const int ENV_RAY_COUNT = 8;
+const float ENV_RAY_ANGLES[ENV_RAY_COUNT] = {-1.5708f, -1.0472f, -0.5236f, -0.1745f, 0.1745f, 0.5236f, 1.0472f, 1.5708f}; // Radians off the heading
+const float ENV_RAY_RANGE = 320.0f; // Pixels
+const float ENV_RAY_STEP = 16.0f; // Pixels between samples along a ray
+const int ENV_OBS_SIZE = 11 + ENV_RAY_COUNT;
+
+// One player's ENV_OBS_SIZE observation, as VecEnv reports it; collision
+// probes the rays, so it must be safe to call from the caller's thread
+void observeFeatures(const GameState& state, const GameConfig& config, int player, CollisionBackend& collision, float* out);
+
+struct EnvStep {
+    const float* observations;
+    const float* rewards;
+    const uint8_t* dones;
+};
+
+class VecEnv {
+public:
+    VecEnv(const GameConfig& config, JobSystem& jobs, float tickRate = 60.0f, float maxRoundSeconds = 180.0f);
+
+    // Starts batch new matches, seeded seed, seed + 1, ...; observations()
+    // then holds their first observations
+    void reset(int batch, uint32_t seed);
+    EnvStep step(const PlayerInput* actions); // actions[match * 2 + player]
+
+    int batch() const { return static_cast<int>(matches.size()); }
+    const GameState& match(int index) const { return matches[index]; }
+    const float* observations() const { return observationData.data(); }
+    void observeGrids(float* out, int level = OBS_DEFAULT_LEVEL) const;
+    void observeGrids(uint8_t* out, int level = OBS_DEFAULT_LEVEL) const;
+
+private:
+    void stepMatch(int index, const PlayerInput* actions);
+    void observe(int index);
+    template <typename Out> void observeGridsInto(Out* out, int level) const;
+
+    GameConfig config;
+    JobSystem& jobs;
+    float dt;
+    uint64_t maxRoundUs;
+    CpuCollision collision; // Stateless, shared by every thread
+    std::vector<GameState> matches;
+    std::vector<float> observationData;
+    std::vector<float> rewardData;
+    std::vector<uint8_t> doneData;
+};
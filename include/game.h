@@ -0,0 +1,231 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "config.h"
+#include "rng.h"
+#include "scheduler.h"
+
+class JobSystem;
+
+// Simulation core shared by the windowed game and the headless tools. Nothing
+// here touches SDL or GL; collision goes through a CollisionBackend so the
+// game can keep its pixel readback while headless runs use geometry.
+
+const int WIDTH = 1920, HEIGHT = 1080;
+const int PLAYER_SIZE = 4; // Player pixel size (quad)
+const int TRAIL_SIZE = 2; // Trail pixel size (quad)
+const int COLLISION_CHECK_SIZE = 5; // Size of square area to check for collisions (pixels)
+const int SELF_TRAIL_SKIP = 5; // Newest own trail points ignored by collision
+const float TRAIL_SPACING = TRAIL_SIZE; // Head travel that lays a trail point (pixels); squares still touch
+const float TRAIL_TURN = 0.2f; // Heading change (radians) that lays one after half that travel
+
+struct Vec2 {
+    float x, y;
+    Vec2(float x = 0, float y = 0) : x(x), y(y) {}
+    Vec2 operator+(const Vec2& other) const { return Vec2(x + other.x, y + other.y); }
+    Vec2 operator*(float s) const { return Vec2(x * s, y * s); }
+};
+
+struct Color {
+    uint8_t r, g, b, a;
+};
+
+// Arena tiles for trail storage: points never move once laid, so each one
+// lives in the bucket of the tile it landed in. Collision probes only read
+// the tiles under the head, and erasure splits the arena into disjoint tile
+// ranges that can run on different threads.
+const int TRAIL_TILE_SIZE = 64; // Tile side (pixels)
+const int TRAIL_TILES_X = (WIDTH + TRAIL_TILE_SIZE - 1) / TRAIL_TILE_SIZE;
+const int TRAIL_TILES_Y = (HEIGHT + TRAIL_TILE_SIZE - 1) / TRAIL_TILE_SIZE;
+const int TRAIL_TILE_COUNT = TRAIL_TILES_X * TRAIL_TILES_Y;
+
+struct TrailPoint {
+    Vec2 pos;
+    uint32_t seq; // Order laid; newest points have the highest
+};
+
+class Trail {
+public:
+    // Where the next point goes: everything but the points themselves
+    struct Cursor {
+        uint32_t nextSeq;
+        Vec2 newestPos, newestDirection;
+    };
+
+    Trail() : tiles(TRAIL_TILE_COUNT), nextSeq(0) { markAllDirty(); }
+
+    void push(const Vec2& pos);
+    // Heads lay points by distance and heading instead of every tick, so a
+    // trail holds the same line at any tick rate: at 60Hz every tick's move
+    // is over TRAIL_SPACING and lays a point, at 240Hz about every third
+    // does. True if pos was laid.
+    bool sample(const Vec2& pos, const Vec2& direction);
+    void clear();
+    size_t size() const;
+    bool recent(const TrailPoint& point, uint32_t newest) const { return point.seq + newest >= nextSeq; } // One of the newest laid
+    const std::vector<TrailPoint>& tile(int index) const { return tiles[index]; }
+
+    // Removes the points of one tile matching pred. Calls for different tiles
+    // touch disjoint data and may run concurrently.
+    template <typename Pred>
+    void eraseIf(int index, Pred pred) {
+        auto& points = tiles[index];
+        auto end = std::remove_if(points.begin(), points.end(), pred);
+        if (end == points.end()) return;
+        points.erase(end, points.end());
+        dirtyTiles[index] = 1;
+    }
+
+    // Tiles changed since the last clearDirty(), for delta snapshots. One
+    // byte per tile, so concurrent eraseIf calls never share a flag.
+    bool dirty(int index) const { return dirtyTiles[index] != 0; }
+    void clearDirty() { std::fill(dirtyTiles, dirtyTiles + TRAIL_TILE_COUNT, 0); }
+    void setTile(int index, const TrailPoint* points, size_t count); // Marks it dirty
+    void place(const TrailPoint& point); // Appends a saved point as is; restore the cursor after
+    Cursor cursor() const { return Cursor{nextSeq, newestPos, newestDirection}; }
+    void setCursor(const Cursor& cursor);
+
+    static int tileX(float x); // Column of x, clamped to the arena
+    static int tileY(float y);
+
+private:
+    void markAllDirty() { std::fill(dirtyTiles, dirtyTiles + TRAIL_TILE_COUNT, 1); }
+
+    std::vector<std::vector<TrailPoint>> tiles; // Row major, TRAIL_TILES_X wide
+    uint32_t nextSeq;
+    Vec2 newestPos, newestDirection; // Where and which way the newest point was laid
+    uint8_t dirtyTiles[TRAIL_TILE_COUNT];
+};
+
+// What a head ran into, for kill credit
+enum HitSource {
+    HIT_NONE,
+    HIT_TRAIL, // Player 0's trail; HIT_TRAIL + 1 is player 1's
+    HIT_CIRCLE = HIT_TRAIL + 2,
+    HIT_WALL,
+    HIT_UNKNOWN // The backend only knows something was drawn there
+};
+
+struct Player {
+    Vec2 pos;
+    Vec2 direction;
+    Color color;
+    Trail trail;
+    bool alive;
+    bool willDie; // Flag for next-frame death
+    bool hasMoved; // Flag for invincibility
+    int killedBy; // HitSource that set willDie
+};
+
+struct Circle {
+    Vec2 pos;
+    Vec2 vel;
+    float radius;
+};
+
+struct Collectible {
+    Vec2 pos;
+    float size; // Green square size
+    float blackCircleSize; // Black circle radius
+    float blackSquareSize; // Black square size
+};
+
+struct PlayerInput {
+    int16_t leftTrigger, rightTrigger; // Controller axis values, 0..32767
+};
+
+// Independent random streams, so drawing more from one (an extra circle)
+// leaves the others' sequences alone
+enum RngStream {
+    RNG_CIRCLES, // Spawn position and heading
+    RNG_COLLECTIBLES,
+    RNG_STREAM_COUNT
+};
+
+// Scheduler event types
+enum TimerType {
+    TIMER_SPAWN_CIRCLE,
+    TIMER_COUNTDOWN
+};
+
+// Bits returned by stepGame
+enum GameEvent {
+    GAME_EVENT_COLLECTIBLE = 1, // A player picked up the green square
+    GAME_EVENT_ROUND_OVER = 2, // A player died; the score screen starts
+    GAME_EVENT_ROUND_START = 4 // Countdown finished and the arena was reset
+};
+
+struct GameState {
+    Player players[2];
+    std::vector<Circle> circles;
+    Collectible collectible;
+    int scores[2];
+    bool gameOver; // Score screen is showing
+    int countdown; // Seconds left on the score screen
+    Rng rng[RNG_STREAM_COUNT]; // Seeded from the match seed, one stream each
+    Scheduler scheduler; // Timed events run on simulation time so replays fire them identically
+    uint64_t simTimeUs;
+    uint64_t roundStartUs;
+    TimerId spawnTimer;
+    TimerId countdownTimer;
+};
+
+// Answers whether anything a head can die on is drawn around pos, and what.
+class CollisionBackend {
+public:
+    virtual ~CollisionBackend() {}
+    virtual int hit(const GameState& state, int player, const Vec2& pos) = 0; // HitSource, HIT_NONE if clear
+    virtual bool concurrent() const { return false; } // Safe to call from worker threads
+    // Once per tick before the hit() calls, with every head that will be
+    // tested (active), so a backend can batch the tick's work
+    virtual void prepare(const GameState& state, const Vec2 heads[2], const bool active[2]) { (void)state; (void)heads; (void)active; }
+};
+
+// Tests the same shapes the renderer draws (trail quads, circles) directly
+// against the COLLISION_CHECK_SIZE pixel area, without a framebuffer.
+class CpuCollision : public CollisionBackend {
+public:
+    int hit(const GameState& state, int player, const Vec2& pos) override;
+    bool concurrent() const override { return true; }
+};
+
+// Reports what another backend found on the head's previous tick, the way
+// OcclusionCollision's queries do, so replays recorded with occlusion
+// collision play back on the CPU with hits on the same ticks. Only the
+// previous tick of the same round counts, as with the occlusion probes.
+class LateCollision : public CollisionBackend {
+public:
+    explicit LateCollision(CollisionBackend& inner) : inner(inner) {}
+    int hit(const GameState& state, int player, const Vec2& pos) override;
+    bool concurrent() const override { return inner.concurrent(); } // hit() only touches its own player's slot
+    void prepare(const GameState& state, const Vec2 heads[2], const bool active[2]) override;
+
+private:
+    struct Pending {
+        int source = HIT_NONE;
+        uint64_t tick = 0, round = 0, timeUs = 0; // When it was tested, as OcclusionCollision::Probe
+    };
+
+    CollisionBackend& inner;
+    Pending pending[2];
+    uint64_t tick = 0; // Bumped by every prepare()
+};
+
+uint64_t secondsToUs(float seconds);
+
+void newGame(GameState& state, const GameConfig& config, uint32_t seed); // Scores to zero, fresh round
+void resetRound(GameState& state, const GameConfig& config);
+void applyConfig(GameState& state, GameConfig& config, const GameConfig& next); // Call between ticks
+
+// Advances the simulation by dt seconds; returns GameEvent bits. With a job
+// system the tick runs as a task graph (see game.cpp); without one the same
+// tasks run in order on the caller. Both heads are tested against the arena
+// as it was at the start of the tick, so results match either way.
+int stepGame(GameState& state, const GameConfig& config, const PlayerInput inputs[2], float dt, CollisionBackend& collision, JobSystem* jobs = nullptr);
+
+// Circles erase the trail points they cover. Work is split by arena tile, so
+// the trails come out the same for any thread count.
+void eraseTrails(GameState& state, JobSystem* jobs = nullptr);
+
+bool checkCollectibleCollision(const Vec2& playerPos, const Collectible& collectible);
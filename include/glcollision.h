@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "game.h"
+#include "render.h"
+
+// Collision backends that test against what the GPU draws. All of them run
+// GL commands, so they are not concurrent and stay on the GL thread.
+
+// The original collision test: draw everything a head can hit, then read the
+// pixels around the head back with glReadPixels. Every test stalls until the
+// GPU has finished drawing.
+class ReadbackCollision : public CollisionBackend {
+public:
+    int hit(const GameState& state, int player, const Vec2& pos) override; // HIT_UNKNOWN on a hit
+
+private:
+    RenderList list;
+};
+
+// Same test without reading pixels: trails and circles go into the stencil
+// buffer, then the COLLISION_CHECK_SIZE probe is drawn as a quad inside an
+// occlusion query that counts the samples landing on stencil. The stencil is
+// filled once per tick for both heads (bits tell the players' newest points
+// apart, so each head still skips its own). A query is read back on the
+// player's next test, a frame later, when the GPU is done with it, so a hit
+// reaches the game one tick later than with readback.
+class OcclusionCollision : public CollisionBackend {
+public:
+    bool init(); // Needs the GL context; false without occlusion queries or a stencil buffer
+    void prepare(const GameState& state, const Vec2 heads[2], const bool active[2]) override;
+    int hit(const GameState& state, int player, const Vec2& pos) override; // HIT_UNKNOWN on a hit
+
+private:
+    struct Probe {
+        unsigned int query = 0;
+        bool pending = false; // Issued and not read yet
+        uint64_t tick = 0; // prepare() count it was issued in; only last tick's is read
+        uint64_t round = 0; // roundStartUs it was issued in; a new round drops it
+        uint64_t timeUs = 0; // simTimeUs it was issued at; a rewind or new game drops it
+    };
+
+    void fillStencil(const GameState& state);
+
+    Probe probes[2];
+    RenderList base, recent[2]; // Recorded per fill, kept for their capacity
+    bool filled = false; // This tick's stencil is drawn
+    uint64_t tick = 0; // Bumped by every prepare()
+};
+
+// Object ids instead of colors: once per tick (prepare) the arena is drawn
+// into an offscreen single-channel target at 1/SCALE resolution, each pixel
+// holding the HitSource of what covers it, and one rectangle spanning every
+// active head's probe is read back. Each hit() then only looks at its part of
+// that rectangle, and can tell whose trail or a circle it hit. Probes are
+// rounded out to whole target pixels.
+class IdBufferCollision : public CollisionBackend {
+public:
+    static const int SCALE = 2;
+    static const int TARGET_WIDTH = WIDTH / SCALE, TARGET_HEIGHT = HEIGHT / SCALE;
+
+    bool init(); // Needs the GL context; false without framebuffer objects
+    void prepare(const GameState& state, const Vec2 heads[2], const bool active[2]) override;
+    int hit(const GameState& state, int player, const Vec2& pos) override;
+
+private:
+    struct Rect {
+        int x0, y0, x1, y1; // Target pixels, inclusive, y down
+    };
+
+    static Rect probeRect(const Vec2& pos);
+
+    RenderList list;
+    std::vector<uint8_t> ids; // The read rectangle, bottom row first as GL returns it
+    Rect read = {0, 0, -1, -1};
+    unsigned int framebuffer = 0;
+};
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <GL/gl.h>
+
+// GL entry points past 1.1, looked up at runtime through SDL once a context
+// exists: the GL libraries on Windows and several ports only export 1.1, and
+// drivers differ in what they add. A group is loaded only when the context's
+// GL_VERSION or extension string says it has the feature (core names, or the
+// ARB/EXT ones); otherwise its pointers stay null, so callers check before use.
+
+// GL 1.5 / ARB_occlusion_query, GL 3.3 / ARB_timer_query
+#ifndef GL_SAMPLES_PASSED
+#define GL_SAMPLES_PASSED 0x8914
+#endif
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT 0x8866
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED 0x88BF
+#endif
+// GL 3.0 / ARB_framebuffer_object / EXT_framebuffer_object
+#ifndef GL_FRAMEBUFFER
+#define GL_FRAMEBUFFER 0x8D40
+#define GL_RENDERBUFFER 0x8D41
+#define GL_COLOR_ATTACHMENT0 0x8CE0
+#define GL_FRAMEBUFFER_COMPLETE 0x8CD5
+#endif
+#ifndef GL_R8
+#define GL_R8 0x8229
+#endif
+
+struct GlFunctions {
+    // Queries
+    void (APIENTRY* genQueries)(GLsizei n, GLuint* ids);
+    void (APIENTRY* beginQuery)(GLenum target, GLuint id);
+    void (APIENTRY* endQuery)(GLenum target);
+    void (APIENTRY* getQueryObjectuiv)(GLuint id, GLenum name, GLuint* value);
+    void (APIENTRY* getQueryObjectui64v)(GLuint id, GLenum name, uint64_t* value);
+    // Framebuffer objects
+    void (APIENTRY* genFramebuffers)(GLsizei n, GLuint* ids);
+    void (APIENTRY* bindFramebuffer)(GLenum target, GLuint id);
+    void (APIENTRY* genRenderbuffers)(GLsizei n, GLuint* ids);
+    void (APIENTRY* bindRenderbuffer)(GLenum target, GLuint id);
+    void (APIENTRY* renderbufferStorage)(GLenum target, GLenum format, GLsizei width, GLsizei height);
+    void (APIENTRY* framebufferRenderbuffer)(GLenum target, GLenum attachment, GLenum renderTarget, GLuint id);
+    GLenum (APIENTRY* checkFramebufferStatus)(GLenum target);
+
+    bool occlusionQueries() const { return genQueries && beginQuery && endQuery && getQueryObjectuiv; }
+    bool timerQueries() const { return occlusionQueries() && getQueryObjectui64v; }
+    bool framebufferObjects() const {
+        return genFramebuffers && bindFramebuffer && genRenderbuffers && bindRenderbuffer && renderbufferStorage &&
+               framebufferRenderbuffer && checkFramebufferStatus;
+    }
+};
+
+extern GlFunctions glFuncs;
+
+void loadGlFunctions(); // GL thread, after the context is created
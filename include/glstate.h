@@ -0,0 +1,111 @@
+#pragma once
+#include <cstdint>
+#include <GL/gl.h>
+#include "profiler.h"
+
+// Thin layer over the fixed-function GL calls the game makes. It remembers
+// the state it last set and drops calls that would not change it, and keeps
+// immediate-mode batches open across color changes (glColor is legal inside
+// glBegin/glEnd), so consecutive runs of the same primitive share one batch.
+// Anything that is not legal inside a batch closes it first.
+//
+// Debug builds also count draw calls, vertices, state changes, redundant
+// calls dropped and bytes moved to and from the GPU per frame, for the
+// profiler and telemetry. Release builds (-DNDEBUG: cross builds and
+// make RELEASE=1) compile the counters out.
+//
+// GL thread only, and all GL state the renderer depends on has to go through
+// here, or the cache goes stale.
+
+#ifndef NDEBUG
+#define LINES_GL_STATS
+#endif
+
+#ifdef LINES_GL_STATS
+#define GL_STAT(expr) (expr)
+#else
+#define GL_STAT(expr) ((void)0)
+#endif
+
+class GlState {
+public:
+    GlState() { invalidate(); }
+
+    void invalidate(); // Forget the cache, e.g. after creating a context
+
+    void color(uint8_t r, uint8_t g, uint8_t b) {
+        uint32_t rgb = static_cast<uint32_t>(r) << 16 | g << 8 | b;
+        if (rgb == currentColor) {
+            GL_STAT(frame.redundantCalls++);
+            return;
+        }
+        currentColor = rgb;
+        glColor3ub(r, g, b);
+        GL_STAT(frame.stateChanges++);
+        GL_STAT(frame.bytesUploaded += 3);
+    }
+
+    // Opens a batch of mode, or keeps the open one if it is the same mode
+    void begin(GLenum mode) {
+        if (batch == mode) return;
+        flush();
+        glBegin(mode);
+        batch = mode;
+        GL_STAT(frame.drawCalls++);
+    }
+
+    void vertex(float x, float y) {
+        glVertex2f(x, y);
+        GL_STAT(frame.vertices++);
+        GL_STAT(frame.bytesUploaded += 2 * sizeof(float));
+    }
+
+    void flush() {
+        if (batch == UNSET) return;
+        glEnd();
+        batch = UNSET;
+    }
+
+    void enable(GLenum cap, bool on);
+    void colorMask(bool on);
+    void stencilFunc(GLenum func, GLint ref, GLuint mask);
+    void stencilMask(GLuint mask);
+    void stencilOp(GLenum fail, GLenum depthFail, GLenum pass);
+    void clearColor(float r, float g, float b, float a);
+    void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+    void clear(GLbitfield mask);
+    void readPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, void* pixels); // Unsigned bytes
+    void uploaded(size_t bytes) { GL_STAT(frame.bytesUploaded += bytes); (void)bytes; } // Texture data sent by other APIs
+
+    DrawStats endFrame(); // This frame's counts (zero without LINES_GL_STATS); starts the next
+
+private:
+    static const GLenum UNSET = 0xffffffff; // No batch open, or enum state not known yet
+    static const uint32_t NO_COLOR = 0xffffffff;
+
+    // Counts the call; closes the batch only when it reaches GL
+    bool changed(bool different) {
+        if (!different) {
+            GL_STAT(frame.redundantCalls++);
+            return false;
+        }
+        flush();
+        GL_STAT(frame.stateChanges++);
+        return true;
+    }
+
+    GLenum batch;
+    uint32_t currentColor;
+    int stencilTest, dither; // -1 unknown
+    int colorWrite;
+    GLenum stencilFn;
+    GLint stencilRef;
+    GLuint stencilFnMask, stencilWriteMask;
+    bool stencilWriteKnown;
+    GLenum stencilOps[3];
+    float clearRgba[4];
+    GLint view[4];
+    DrawStats frame;
+};
+
+extern GlState glState;
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include "profiler.h"
+
+// GL_TIME_ELAPSED queries around render stages. A frame's queries are only
+// read once the GPU reports the last of them available, a few frames later,
+// so timing never stalls the pipeline; finished frames go to
+// Profiler::addGpuFrame. Timer queries do not nest, so begin() closes the open
+// zone first and a zone may be opened several times per frame. Without timer
+// query support (GL < 3.3 and no ARB/EXT_timer_query) everything is a no-op.
+
+class GpuTimer {
+public:
+    static const int FRAMES_IN_FLIGHT = 4; // A frame still unresolved after this many is dropped
+    static const int QUERIES_PER_FRAME = 16;
+
+    GpuTimer();
+
+    bool init(); // GL thread, after loadGlFunctions(); false without timer queries
+    void beginFrame(Profiler& profiler); // Hands over resolved frames, then starts recording the next
+    void begin(GpuZone zone); // No-op if zone is already open
+    void end();
+    uint64_t droppedFrames() const { return dropped; }
+
+private:
+    struct Frame {
+        unsigned int queries[QUERIES_PER_FRAME];
+        uint8_t zones[QUERIES_PER_FRAME];
+        int count; // Queries issued
+        bool pending; // Issued, not resolved yet
+    };
+
+    bool enabled;
+    Frame frames[FRAMES_IN_FLIGHT];
+    int current;
+    int open; // Zone with an active query, -1 for none
+    uint64_t dropped;
+};
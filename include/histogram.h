@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Log-linear histogram of durations in microseconds (HdrHistogram layout):
+// 32 linear sub-buckets per power of two, so any recorded value is reported
+// within ~3% from 1us up to hours. record() is O(1) and never allocates.
+class Histogram {
+public:
+    static const int SUB_BUCKET_BITS = 5;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+
+    Histogram();
+    void record(uint64_t us);
+    void clear();
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return maxValue; }
+    uint64_t percentile(double p) const; // p in [0, 100]; upper bound of the bucket reached
+
+private:
+    static int bucketIndex(uint64_t us);
+    static uint64_t bucketUpperBound(int index);
+
+    std::vector<uint64_t> counts;
+    uint64_t total;
+    uint64_t maxValue;
+};
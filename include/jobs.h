@@ -0,0 +1,99 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+#ifndef LINES_NO_THREADS
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+#ifdef LINES_NO_THREADS
+#define LINES_THREAD_LOCAL
+#else
+#define LINES_THREAD_LOCAL thread_local
+#endif
+
+// A set of tasks with dependencies, run by JobSystem::run(). Build it, run it,
+// and run it again if the shape is the same; dependency counters are reset on
+// every run. Pinned tasks only run on the thread that called run() (GL work).
+class TaskGraph {
+public:
+    typedef int Task;
+
+    Task add(std::function<void()> fn, bool pinned = false);
+    void depend(Task task, Task on); // task starts after on finishes
+    void clear() { nodes.clear(); }
+    size_t size() const { return nodes.size(); }
+
+private:
+    friend class JobSystem;
+
+    struct Node {
+        std::function<void()> fn;
+        std::vector<Task> successors;
+        int dependencies;
+        bool pinned;
+    };
+
+    std::vector<Node> nodes;
+    std::unique_ptr<std::atomic<int>[]> pending; // Per-node dependencies left this run
+    size_t pendingCapacity = 0;
+    std::atomic<int> remaining{0};
+#ifndef LINES_NO_THREADS
+    std::mutex pinnedMutex;
+#endif
+    std::deque<Task> pinnedReady;
+};
+
+// Work-stealing job system: one deque per worker; owners push and pop at the
+// back, idle workers steal from the front of the others. The thread calling
+// run() helps execute until its graph is done, and blocks like a worker when
+// there is nothing it can run. With one thread (or LINES_NO_THREADS)
+// everything runs inline on the caller.
+class JobSystem {
+public:
+    explicit JobSystem(int threads = 0); // Total threads including the caller; 0 = all cores
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    int threadCount() const { return static_cast<int>(queues.size()); }
+    void run(TaskGraph& graph);
+
+    // Splits [0, count) into chunks of at least grain and runs fn(begin, end) on each
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn);
+
+    static void runSerial(TaskGraph& graph); // Same semantics, caller only
+
+private:
+    struct Job {
+        TaskGraph* graph;
+        TaskGraph::Task task;
+    };
+
+    struct alignas(64) Queue {
+#ifndef LINES_NO_THREADS
+        std::mutex mutex;
+#endif
+        std::deque<Job> jobs;
+    };
+
+    void submit(TaskGraph& graph, TaskGraph::Task task);
+    bool takeJob(size_t self, Job& job);
+    void execute(const Job& job);
+    static void start(TaskGraph& graph);
+    void workerLoop(size_t index);
+
+    std::vector<std::unique_ptr<Queue>> queues; // [0] is shared by non-worker threads
+    std::atomic<bool> stopping;
+    std::atomic<int> queued;
+#ifndef LINES_NO_THREADS
+    std::vector<std::thread> workers;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+#endif
+};
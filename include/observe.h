@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "game.h"
+
+// Egocentric occupancy grids for learning bots: what is around each head,
+// turned so the head points up the grid, downsampled to a fixed size.
+//
+// OccupancyMap marks the arena's blocked cells (trails, circles) at
+// OCCUPANCY_CELL pixels, outside the arena counting as blocked, then box
+// filters it down OCCUPANCY_LEVELS - 1 times, 2x2 cells at a time (SSE2 or
+// NEON where there is one), so level n holds the blocked fraction of
+// OCCUPANCY_CELL << n pixel squares as 0-255. observeHeads() samples a
+// level bilinearly on a rotated OBS_GRID x OBS_GRID lattice, one level cell
+// per grid cell, so level 1 sees a 512 pixel square. Row 0 is straight
+// ahead of the head, the head is at the middle, columns run left to right.
+//
+// A map allocates once, when constructed; build() and observeHeads() only
+// write into memory they are given, so a batch of heads over any number of
+// maps is one call without allocation.
+
+const int OCCUPANCY_CELL = 4; // Pixels per level 0 cell
+const int OCCUPANCY_LEVELS = 3; // 4, 8 and 16 pixel cells
+const int OBS_GRID = 64; // Cells a side
+const int OBS_GRID_CELLS = OBS_GRID * OBS_GRID;
+const int OBS_DEFAULT_LEVEL = 1;
+
+// Averages each 2x2 block of src (width x height, both even) into dst
+// (width / 2 x height / 2), rounding to nearest
+void boxFilter2x2(const uint8_t* src, int width, int height, uint8_t* dst);
+
+class OccupancyMap {
+public:
+    OccupancyMap();
+
+    void build(const GameState& state); // Marks and filters every level
+
+    int width(int level) const { return LEVEL0_WIDTH >> level; }
+    int height(int level) const { return LEVEL0_HEIGHT >> level; }
+    const uint8_t* level(int index) const { return levels[index].data(); } // Row major, width(index) wide
+
+private:
+    // Padded with blocked cells to a multiple of 1 << (OCCUPANCY_LEVELS - 1), so every level halves exactly
+    static const int LEVEL_ALIGN = 1 << (OCCUPANCY_LEVELS - 1);
+    static const int LEVEL0_WIDTH = (WIDTH / OCCUPANCY_CELL + LEVEL_ALIGN - 1) / LEVEL_ALIGN * LEVEL_ALIGN;
+    static const int LEVEL0_HEIGHT = (HEIGHT / OCCUPANCY_CELL + LEVEL_ALIGN - 1) / LEVEL_ALIGN * LEVEL_ALIGN;
+
+    std::vector<uint8_t> levels[OCCUPANCY_LEVELS];
+};
+
+struct ObservationHead {
+    const OccupancyMap* map;
+    Vec2 pos, direction; // direction is a unit vector
+};
+
+// OBS_GRID_CELLS values per head, heads one after another: blocked
+// fraction as 0-1 floats, or 0-255 bytes
+void observeHeads(const ObservationHead* heads, int count, float* out, int level = OBS_DEFAULT_LEVEL);
+void observeHeads(const ObservationHead* heads, int count, uint8_t* out, int level = OBS_DEFAULT_LEVEL);
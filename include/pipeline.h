@@ -0,0 +1,143 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include "game.h"
+#include "queues.h"
+#include "render.h"
+#include "replay.h"
+#include "rewind.h"
+#ifndef LINES_NO_THREADS
+#include <thread>
+#endif
+
+class CheckpointWriter;
+class JobSystem;
+class Telemetry;
+
+// Hand-off between the frame loop's stages. The input stage (SDL events,
+// controllers or the replay file, on the main thread) submits frames and
+// config changes in order; the sim stage applies them and publishes
+// snapshots of the arena for the render stage to draw.
+//
+//   input --SpscQueue<SimInput>--> sim --SpscQueue<Snapshot*>--> render
+//                                      <--SpscQueue<Snapshot*>-- (spares)
+//
+// With a concurrent collision backend the sim stage gets its own thread,
+// records each snapshot's draw list there, and render submits the newest one. GL readback collision needs the GL
+// thread, so then the sim runs inline from pump() and render reads the live
+// state. Round records go to telemetry from the sim stage, frame records
+// from the render stage.
+//
+// Run-ahead (runAhead > 0) hides a few frames of input latency the way
+// emulators do: after each batch of real ticks the arena is copied and the
+// copy stepped runAhead more ticks with the newest input, and that predicted
+// arena is what gets drawn. The real state never sees the extra ticks, so
+// replays and telemetry are unchanged; a wrong guess (the input changes)
+// is simply replaced by the next frame's prediction. Copies reuse the
+// destination's trail buffers, so saving costs a memcpy of the points.
+// Predicted ticks collide on the CPU whatever the backend, since GL
+// collision keeps per-tick state of its own and only the real ticks may
+// touch it.
+//
+// With a RewindRing (rewindTicks > 0) every real tick is captured after it
+// runs. A SIM_SCRUB input shows a past tick instead of the live arena until
+// the next frame arrives; SIM_REWIND makes a past tick the live state and
+// play continues from it.
+//
+// With a CheckpointWriter the live state is handed to it every
+// CHECKPOINT_INTERVAL_US of sim time and whenever the score or round
+// changes. submit() only copies the state; when the writer is still busy
+// the checkpoint waits for the next tick.
+
+enum SimInputType {
+    SIM_FRAME, // One tick of frame
+    SIM_CONFIG, // Apply config between ticks
+    SIM_SCRUB, // Show the tick ticksBack before the newest
+    SIM_REWIND // Go back to it for good
+};
+
+struct SimInput {
+    SimInputType type;
+    ReplayFrame frame;
+    GameConfig config;
+    int ticksBack; // SIM_SCRUB and SIM_REWIND
+};
+
+struct SimFrame {
+    const GameState* state; // Valid until the next latest() call
+    RenderList* list; // drawScene() of state, or null when the caller has to record it
+    int events; // GameEvent bits since the previous latest()
+    uint64_t tickUs; // Time spent in stepGame since the previous latest()
+    uint64_t aheadUs; // Time spent copying and stepping run-ahead arenas, likewise
+    int scrubTicks; // How far back state is while scrubbing, -1 when live
+    int rewindTicks; // Ticks the rewind ring holds
+};
+
+class SimStage {
+public:
+    static const int MAX_RUN_AHEAD = 4; // Ticks; --bench runahead checks they fit a 60Hz frame
+
+    // state and config are owned by the stage until it is destroyed
+    SimStage(GameState& state, const GameConfig& config, CollisionBackend& collision, JobSystem& jobs, Telemetry& telemetry, bool threaded,
+             int runAhead = 0, int rewindTicks = 0, CheckpointWriter* checkpoints = nullptr);
+    ~SimStage(); // Steps whatever is still queued, then stops the thread
+    SimStage(const SimStage&) = delete;
+    SimStage& operator=(const SimStage&) = delete;
+
+    void submit(const SimInput& input); // Input stage; waits while the queue is full
+    void pump(); // Inline mode: run everything submitted so far
+    SimFrame latest(); // Render stage
+    bool threaded() const { return ownThread; }
+
+private:
+    static const size_t INPUT_CAPACITY = 256; // Frames the sim may fall behind
+    static const int SNAPSHOT_COUNT = 3; // One drawn, one ready, one being written
+
+    struct Snapshot {
+        GameState state;
+        RenderList list;
+        int events;
+        uint64_t tickUs;
+        uint64_t aheadUs;
+        int scrubTicks;
+        int rewindTicks;
+    };
+
+    bool step(); // Applies one queued input; false if there was none
+    void predict(GameState& into); // Copies state to into, then steps the copy runAhead ticks
+    void scrub(int ticksBack);
+    void checkpoint();
+    void publish();
+    void simLoop();
+
+    GameState& state;
+    GameConfig config;
+    CollisionBackend& collision;
+    JobSystem& jobs;
+    Telemetry& telemetry;
+    bool ownThread;
+    int runAhead;
+    CpuCollision aheadCollision;
+    GameState ahead; // Inline mode's predicted arena; threaded mode predicts into the snapshot
+    PlayerInput lastInputs[2]; // Newest frame, repeated by the predicted ticks
+    float lastDt;
+    std::unique_ptr<RewindRing> rewindRing; // Null without rewind
+    GameState scrubView;
+    int scrubTicks; // Sim side
+    CheckpointWriter* checkpoints; // Null without --checkpoint
+    uint64_t nextCheckpointUs;
+    bool checkpointDue; // Waiting for the writer
+    SpscQueue<SimInput> inputs;
+    SpscQueue<Snapshot*> ready; // Sim -> render
+    SpscQueue<Snapshot*> spare; // Render -> sim
+    Snapshot snapshots[SNAPSHOT_COUNT];
+    Snapshot* shown; // Render side
+    int pendingEvents; // Sim side, not yet published
+    uint64_t pendingTickUs;
+    uint64_t pendingAheadUs;
+    std::atomic<bool> stopping;
+#ifndef LINES_NO_THREADS
+    std::thread thread;
+#endif
+};
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "game.h"
+
+class OccupancyMap;
+
+// A small fully connected network, evaluated on the CPU for bots trained
+// against VecEnv. Layers are matrix-vector products (SSE2 or NEON four rows
+// at a time, plain loops elsewhere) plus bias and activation; weights are
+// kept with rows and columns padded to four floats of zeros so the kernels
+// have no tails. Evaluating allocates nothing once a thread has run the
+// widest network it will see.
+//
+// The weight file is in native byte order, as replays are; the magic rejects
+// a file written on a machine of the other endianness:
+//
+//   u32 magic "LNMP", u32 version, u32 layer count, u32 inputs
+//   per layer: u32 outputs, u32 activation (PolicyActivation),
+//              f32 weights[outputs][inputs of the layer], f32 biases[outputs]
+//
+// A layer's inputs are the previous layer's outputs.
+
+const uint32_t POLICY_MAGIC = 0x504d4e4c; // "LNMP"
+const uint32_t POLICY_VERSION = 1;
+const int POLICY_MAX_LAYERS = 16;
+const int POLICY_MAX_WIDTH = 65536; // Inputs or outputs of any one layer
+
+enum PolicyActivation {
+    POLICY_LINEAR,
+    POLICY_RELU,
+    POLICY_TANH,
+};
+
+class Policy {
+public:
+    bool load(const std::string& path); // False, and left empty, if the file is missing or malformed
+    bool parse(const uint8_t* data, size_t size); // Malformed includes any NaN or infinite weight or bias
+
+    bool empty() const { return layers.empty(); }
+    int inputs() const { return inputCount; }
+    int outputs() const { return layers.empty() ? 0 : layers.back().outputs; }
+
+    void evaluate(const float* input, float* output) const; // inputs() in, outputs() out
+    void evaluate(const float* inputs, int count, float* outputs) const; // count bots, one after another
+
+private:
+    struct Layer {
+        int outputs, activation;
+        int rows, stride; // outputs and inputs rounded up to 4
+        size_t weights, biases; // Offsets into params
+    };
+
+    int inputCount = 0;
+    int widest = 0; // Padded
+    std::vector<Layer> layers;
+    std::vector<float> params;
+};
+
+// Turns a policy's first two outputs into triggers: each clamped to 0-1 and
+// scaled to 0..32767, left then right. A NaN or infinite output (a diverged
+// network fed odd inputs) releases that trigger.
+PlayerInput policyAction(const float* outputs);
+
+// Plays one side of a match with a policy. It observes what the policy's
+// input size says it takes: ENV_OBS_SIZE features as VecEnv gives them, or an
+// OBS_GRID_CELLS occupancy grid (observe.h) at OBS_DEFAULT_LEVEL. Between
+// thinks it holds its input, timed as Bot is (outside the scheduler, see
+// bot.h); the default thinks every tick, as VecEnv trains.
+class PolicyBot {
+public:
+    PolicyBot(const Policy& policy, int player, uint64_t thinkIntervalUs = 0);
+    ~PolicyBot();
+
+    static bool accepts(const Policy& policy); // Input size is one of the above, and two outputs or more
+
+    PlayerInput think(const GameState& state, const GameConfig& config); // Call every tick
+    void reset() { nextThinkUs = 0; held = PlayerInput{0, 0}; }
+
+private:
+    const Policy& policy;
+    int player;
+    uint64_t interval;
+    uint64_t nextThinkUs;
+    PlayerInput held;
+    CpuCollision probe;
+    std::unique_ptr<OccupancyMap> map; // Grid policies only
+    std::vector<float> input, output;
+};
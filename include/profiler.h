@@ -0,0 +1,109 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include "game.h"
+#include "histogram.h"
+
+// Per-frame CPU zones, frame/tick duration histograms and a stutter detector.
+// When a frame runs over the stutter threshold, the zones of that frame and
+// the arena load (trail points, circles) are kept as a snapshot so hitches
+// can be matched against trail growth or circle spikes. Involuntary context
+// switches (the OS taking a core away from any of our threads) are counted
+// per frame, to tell scheduler jitter apart from our own slow frames. GPU
+// time of the render stages arrives a few frames late from GpuTimer and is
+// kept next to the CPU zones.
+
+enum ProfileZone {
+    ZONE_INPUT,
+    ZONE_TICK,
+    ZONE_RUNAHEAD, // Predicted ticks; see SimStage
+    ZONE_RENDER,
+    ZONE_SWAP,
+    PROFILE_ZONE_COUNT
+};
+
+const char* const PROFILE_ZONE_NAMES[PROFILE_ZONE_COUNT] = {"input", "tick", "runahead", "render", "swap"};
+
+// Render stages timed on the GPU
+enum GpuZone {
+    GPU_ZONE_COLLISION, // The GL collision backends' passes
+    GPU_ZONE_COLLECTIBLE,
+    GPU_ZONE_CIRCLES,
+    GPU_ZONE_TRAILS, // With the heads
+    GPU_ZONE_TEXT,
+    GPU_ZONE_COUNT
+};
+
+const char* const GPU_ZONE_NAMES[GPU_ZONE_COUNT] = {"collision", "collectible", "circles", "trails", "text"};
+
+// GL calls of one frame, from GlState in debug builds
+struct DrawStats {
+    uint32_t drawCalls; // glBegin/glEnd batches
+    uint32_t vertices;
+    uint32_t stateChanges; // State calls that reached GL
+    uint32_t redundantCalls; // State calls the cache dropped
+    uint32_t bytesUploaded; // Vertex and color data, texture uploads
+    uint32_t bytesRead; // Pixel readback
+};
+
+struct StutterSnapshot {
+    uint64_t frame;
+    uint64_t simTimeUs;
+    float frameMs;
+    float zoneMs[PROFILE_ZONE_COUNT];
+    uint32_t contextSwitches; // Involuntary, during this frame
+    uint32_t trailPoints[2];
+    uint32_t circles;
+};
+
+uint64_t profilerNowUs(); // Monotonic wall clock
+uint64_t profilerContextSwitches(); // Involuntary switches of the whole process so far; 0 where unsupported
+
+class Profiler {
+public:
+    static const int SNAPSHOT_COUNT = 16; // Most recent stutters kept
+
+    explicit Profiler(float stutterMs = 50.0f);
+
+    void beginFrame();
+    void begin(ProfileZone zone) { zoneStart[zone] = profilerNowUs(); }
+    void end(ProfileZone zone) { zoneUs[zone] += profilerNowUs() - zoneStart[zone]; }
+    void add(ProfileZone zone, uint64_t us) { zoneUs[zone] += us; } // Time measured elsewhere (sim thread)
+    bool endFrame(const GameState& state); // True if this frame stuttered
+    void addGpuFrame(const uint64_t ns[GPU_ZONE_COUNT]); // One frame's GPU zones, whenever they resolve
+    void setDrawStats(const DrawStats& stats); // Call once per frame where GL calls are counted
+
+    float zoneMs(ProfileZone zone) const { return zoneUs[zone] / 1000.0f; }
+    float frameMs() const { return lastFrameUs / 1000.0f; }
+    uint32_t contextSwitches() const { return lastSwitches; } // Last frame
+    bool hasGpu() const { return gpuFrames > 0; }
+    float gpuZoneMs(GpuZone zone) const { return lastGpuNs[zone] / 1e6f; } // Latest resolved frame
+    bool hasDrawStats() const { return drawFrames > 0; }
+    const DrawStats& drawStats() const { return lastDraw; } // Last frame
+    const StutterSnapshot& lastStutter() const { return snapshots[(stutterCount + SNAPSHOT_COUNT - 1) % SNAPSHOT_COUNT]; }
+    const Histogram& frameHistogram() const { return frames; }
+    const Histogram& tickHistogram() const { return ticks; }
+
+    void dump(FILE* out) const;
+
+private:
+    float stutterMs;
+    uint64_t frameCount;
+    uint64_t frameStart;
+    uint64_t lastFrameUs;
+    uint64_t frameSwitches; // Process count at beginFrame
+    uint32_t lastSwitches;
+    uint64_t totalSwitches;
+    uint64_t zoneStart[PROFILE_ZONE_COUNT];
+    uint64_t zoneUs[PROFILE_ZONE_COUNT];
+    uint64_t lastGpuNs[GPU_ZONE_COUNT];
+    uint64_t totalGpuNs[GPU_ZONE_COUNT];
+    uint64_t gpuFrames;
+    DrawStats lastDraw;
+    uint64_t totalDraw[6]; // DrawStats fields, summed
+    uint64_t drawFrames;
+    Histogram frames;
+    Histogram ticks;
+    StutterSnapshot snapshots[SNAPSHOT_COUNT];
+    uint64_t stutterCount;
+};
@@ -0,0 +1,119 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Bounded lock-free queues for handing data between threads. Capacities are
+// rounded up to a power of two. The producer and consumer indices sit on
+// separate cache lines so the two sides do not bounce one line between cores.
+// Neither queue blocks: push() returns false when full, pop() when empty.
+
+const size_t CACHE_LINE = 64;
+
+inline size_t queueCapacity(size_t requested) {
+    size_t capacity = 2;
+    while (capacity < requested) capacity *= 2;
+    return capacity;
+}
+
+// One producer thread, one consumer thread. Each side keeps a private copy of
+// the other side's index and only reloads it when the copy says full/empty.
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity)
+        : mask(queueCapacity(capacity) - 1), slots(new T[mask + 1]), head(0), tailCache(0), tail(0), headCache(0) {}
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    bool push(const T& value) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tailCache > mask) {
+            tailCache = tail.load(std::memory_order_acquire);
+            if (h - tailCache > mask) return false;
+        }
+        slots[h & mask] = value;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == headCache) {
+            headCache = head.load(std::memory_order_acquire);
+            if (t == headCache) return false;
+        }
+        value = slots[t & mask];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+private:
+    const size_t mask;
+    std::unique_ptr<T[]> slots;
+    alignas(CACHE_LINE) std::atomic<size_t> head; // Producer line
+    size_t tailCache;
+    alignas(CACHE_LINE) std::atomic<size_t> tail; // Consumer line
+    size_t headCache;
+    char padding[CACHE_LINE - sizeof(size_t) * 2]; // Keep the next object off the consumer line
+};
+
+// Any number of producer threads, one consumer thread. Each cell carries a
+// sequence number: producers claim a position with a CAS on head, fill the
+// cell, then publish it by bumping its sequence; the consumer reads cells in
+// order and hands them back a lap later.
+template <typename T>
+class MpscQueue {
+public:
+    explicit MpscQueue(size_t capacity) : mask(queueCapacity(capacity) - 1), cells(new Cell[mask + 1]), head(0), tail(0) {
+        for (size_t i = 0; i <= mask; ++i) cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    bool push(const T& value) {
+        size_t pos = head.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells[pos & mask];
+            intptr_t diff = static_cast<intptr_t>(cell->sequence.load(std::memory_order_acquire)) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false; // The consumer has not freed this cell yet
+            } else {
+                pos = head.load(std::memory_order_relaxed); // Another producer took it
+            }
+        }
+        cell->value = value;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& value) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        Cell& cell = cells[pos & mask];
+        if (cell.sequence.load(std::memory_order_acquire) != pos + 1) return false;
+        value = cell.value;
+        cell.sequence.store(pos + mask + 1, std::memory_order_release);
+        tail.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    const size_t mask;
+    std::unique_ptr<Cell[]> cells;
+    alignas(CACHE_LINE) std::atomic<size_t> head; // Shared by producers
+    alignas(CACHE_LINE) std::atomic<size_t> tail; // Consumer only
+    char padding[CACHE_LINE - sizeof(size_t)];
+};
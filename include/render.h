@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "game.h"
+#include "profiler.h"
+
+class GpuTimer;
+
+// The draw functions record into a RenderList instead of calling GL, so a
+// frame can be prepared on any thread; only submitRenderList() touches GL and
+// it has to run on the GL thread. Submission sorts commands by layer, then
+// shape and color, and draws each run of equal keys as one glBegin/glEnd
+// batch. Painter's order only holds between layers: anything that has to end
+// up on top of something else goes on a later layer.
+
+enum RenderLayer {
+    LAYER_COLLECTIBLE_BACK, // Black square and circle around the pickup
+    LAYER_COLLECTIBLE,
+    LAYER_CIRCLES,
+    LAYER_TRAILS, // One layer per player: red is drawn over blue
+    LAYER_PLAYERS = LAYER_TRAILS + 2,
+    LAYER_TEXT
+};
+
+enum DrawShape {
+    SHAPE_SQUARE,
+    SHAPE_CIRCLE
+};
+
+struct DrawItem {
+    float x, y, size; // Square: top-left corner and side; circle: center and radius
+};
+
+struct DrawCommand {
+    uint64_t key; // Layer, shape, color, in submission order
+    uint32_t first, count; // Range in RenderList::items
+};
+
+class RenderList {
+public:
+    void clear();
+    void square(int layer, const Color& color, float x, float y, float size);
+    void circle(int layer, const Color& color, float x, float y, float radius);
+
+    void sort(); // Into submission order; stable, so equal keys keep recording order
+    const std::vector<DrawCommand>& commandList() const { return commands; }
+    const std::vector<DrawItem>& itemList() const { return items; }
+
+private:
+    void add(int layer, DrawShape shape, const Color& color, const DrawItem& item);
+
+    std::vector<DrawCommand> commands; // Consecutive draws with the same key share one
+    std::vector<DrawItem> items;
+};
+
+void drawSquare(RenderList& list, int layer, float x, float y, float size, const Color& color);
+void drawCircle(RenderList& list, int layer, float x, float y, float radius, const Color& color);
+void drawText(RenderList& list, const std::string& text, float x, float y, float squareSize, const Color& color);
+void drawPlayer(RenderList& list, const Player& player);
+void drawTrail(RenderList& list, int layer, const Player& player, int skipRecent = 0);
+
+// Whole frames
+void drawScore(RenderList& list, const GameState& state); // Centered "blue-red"
+void drawScene(RenderList& list, const GameState& state); // Arena, or the score screen when game over
+void drawOverlay(RenderList& list, const Profiler& profiler); // Last frame's numbers, top left
+void drawRewind(RenderList& list, int ticksBack, int ticksHeld); // Scrub bar along the top: what the ring holds, and where
+
+inline Color keyColor(uint64_t key) { return Color{uint8_t(key >> 16), uint8_t(key >> 8), uint8_t(key), 255}; }
+inline DrawShape keyShape(uint64_t key) { return static_cast<DrawShape>(key >> 32 & 0xff); }
+inline int keyLayer(uint64_t key) { return static_cast<int>(key >> 40); }
+
+GpuZone layerZone(int layer); // Which GPU timer zone a layer's draws count to
+void submitRenderList(RenderList& list, GpuTimer* timer = nullptr); // GL thread; sorts the list in place
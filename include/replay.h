@@ -0,0 +1,90 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "game.h"
+#include "snapshot.h"
+
+// Input replays: a header with the RNG seed and the config in effect, then one
+// record per frame (dt and both players' trigger axes). Hot reloads made while
+// recording are stored as config records so playback applies them on the same
+// frame. Native byte order; the magic rejects files from the other endianness.
+// A match that did not start from newGame (picked up from a checkpoint) has
+// its starting state in the header as a flat snapshot (snapshot.h). The
+// header also names the collision backend the match ran with, since occlusion
+// queries report hits a tick later than the others.
+
+const uint32_t REPLAY_MAGIC = 0x50524e4c; // "LNRP"
+const uint32_t REPLAY_VERSION = 4; // 4: collision backend; 3: optional starting snapshot; 2 still plays back; 1 (mt19937, per-tick trails) does not
+
+enum ReplayCollision {
+    REPLAY_COLLISION_UNKNOWN, // Recorded before version 4
+    REPLAY_COLLISION_CPU,
+    REPLAY_COLLISION_READBACK,
+    REPLAY_COLLISION_IDS,
+    REPLAY_COLLISION_OCCLUSION // Hits a tick late
+};
+
+struct ReplayFrame {
+    float dt;
+    int16_t triggers[2][2]; // [player][left, right]
+};
+
+enum ReplayRecord {
+    REPLAY_END,
+    REPLAY_FRAME,
+    REPLAY_CONFIG,
+    REPLAY_ERROR // Truncated or unknown record; nothing after it can be read
+};
+
+class ReplayWriter {
+public:
+    ReplayWriter() : file(nullptr) {}
+    ~ReplayWriter() { close(); }
+    ReplayWriter(const ReplayWriter&) = delete;
+    ReplayWriter& operator=(const ReplayWriter&) = delete;
+
+    bool open(const std::string& path, uint32_t seed, const GameConfig& config, ReplayCollision collision,
+              const GameState* start = nullptr); // start: the match so far
+    void writeFrame(const ReplayFrame& frame);
+    void writeConfig(const GameConfig& config);
+    void close();
+    bool isOpen() const { return file != nullptr; }
+
+private:
+    FILE* file;
+};
+
+class ReplayReader {
+public:
+    ReplayReader() : file(nullptr), seed(0), collision(REPLAY_COLLISION_UNKNOWN) {}
+    ~ReplayReader() { close(); }
+    ReplayReader(const ReplayReader&) = delete;
+    ReplayReader& operator=(const ReplayReader&) = delete;
+
+    bool open(const std::string& path); // Reads the header into seed, config and any starting snapshot
+    ReplayRecord next(ReplayFrame& frame, GameConfig& config);
+    void close();
+    bool isOpen() const { return file != nullptr; }
+
+    uint32_t seedValue() const { return seed; }
+    const GameConfig& headerConfig() const { return config; }
+    ReplayCollision collisionUsed() const { return collision; }
+    const SnapshotView& startSnapshot() const { return start; } // Not open when the match starts from newGame
+    void startMatch(GameState& state) const; // Where the recording began: the snapshot, or newGame from the seed
+
+private:
+    FILE* file;
+    uint32_t seed;
+    GameConfig config;
+    ReplayCollision collision;
+    std::vector<uint8_t> startData; // Read in place by start
+    SnapshotView start;
+};
+
+// The CPU backend to play a replay back with headlessly so hits land on the
+// ticks they did while recording: cpu itself, or late (wrapping cpu) for an
+// occlusion recording. Null when the replay does not say what it ran with.
+CollisionBackend* playbackCollision(const ReplayReader& replay, CpuCollision& cpu, LateCollision& late);
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "game.h"
+
+// The last few seconds of play, one entry per tick, for scrubbing back and
+// resuming from an earlier tick (practice, or looking at what just
+// happened). Every KEYFRAME_INTERVAL ticks the whole GameState is copied;
+// the ticks between store only what changed since the tick before: the
+// trail tiles Trail marked dirty, plus the small per-tick part (heads,
+// circles, collectible, scores, RNG streams, pending timers). Any tick is
+// rebuilt from its keyframe and at most KEYFRAME_INTERVAL - 1 deltas, and
+// comes back exactly as it was, so play can continue from it.
+//
+// Entry and keyframe buffers are reused as the ring wraps, so capture stops
+// allocating once the ring has filled. When full, the oldest keyframe's
+// whole group is dropped, so the ring holds between capacity -
+// KEYFRAME_INTERVAL and capacity ticks.
+class RewindRing {
+public:
+    static const int KEYFRAME_INTERVAL = 60;
+
+    explicit RewindRing(int capacityTicks); // Rounded up to whole keyframe groups
+
+    // After every tick. Clears the trails' dirty tiles, so only one ring may
+    // capture a given state.
+    void capture(GameState& state);
+    void clear();
+
+    int size() const { return static_cast<int>(next - first); } // Ticks held
+    bool empty() const { return next == first; }
+    size_t bytes() const; // Points and timers held, not counting spare capacity
+
+    // The state ticksBack ticks before the newest capture (0 is the newest),
+    // clamped to what the ring holds. False if it is empty.
+    bool view(int ticksBack, GameState& out) const;
+    // Same, then drops the newer ticks so capture carries on from there
+    bool rewind(int ticksBack, GameState& out);
+
+private:
+    struct HeadState {
+        Vec2 pos, direction;
+        bool alive, willDie, hasMoved;
+        int killedBy;
+        Trail::Cursor cursor;
+    };
+
+    struct TileChange {
+        uint16_t player, tile;
+        uint32_t count; // Points, taken in order from Delta::points
+    };
+
+    struct Delta {
+        HeadState heads[2];
+        std::vector<TileChange> tiles;
+        std::vector<TrailPoint> points;
+        std::vector<Circle> circles;
+        Collectible collectible;
+        int scores[2];
+        bool gameOver;
+        int countdown;
+        Rng rng[RNG_STREAM_COUNT];
+        Scheduler::Saved scheduler;
+        uint64_t simTimeUs, roundStartUs;
+        TimerId spawnTimer, countdownTimer;
+    };
+
+    static void saveDelta(GameState& state, Delta& delta);
+    static void applyDelta(const Delta& delta, GameState& state);
+
+    int capacity; // Multiple of KEYFRAME_INTERVAL
+    std::vector<Delta> deltas; // By tick % capacity; unused on keyframe ticks
+    std::vector<GameState> keyframes; // By tick / KEYFRAME_INTERVAL % their count
+    uint64_t first, next; // Ticks held: [first, next), numbered from the first capture
+};
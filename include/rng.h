@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+
+// PCG32 (XSH RR 64/32): 16 bytes of state against mt19937's 2.5KB, so game
+// state snapshots copy it for free. The odd increment picks one of 2^63
+// independent streams, and advance() jumps a stream ahead in O(log n)
+// steps. uniform() is computed here rather than by <random>'s
+// distributions, whose output differs between standard libraries, so
+// replays recorded on one build play back on any other.
+class Rng {
+public:
+    typedef uint32_t result_type; // Usable with <random> distributions too
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return 0xffffffff; }
+
+    Rng() { seed(0, 0); }
+    Rng(uint64_t seedValue, uint64_t stream) { seed(seedValue, stream); }
+
+    void seed(uint64_t seedValue, uint64_t stream);
+    void advance(uint64_t steps); // Same as discarding that many outputs
+
+    result_type operator()() {
+        uint64_t old = state;
+        state = old * MULTIPLIER + increment;
+        uint32_t xorShifted = static_cast<uint32_t>(((old >> 18) ^ old) >> 27);
+        uint32_t rot = static_cast<uint32_t>(old >> 59);
+        return (xorShifted >> rot) | (xorShifted << ((32 - rot) & 31));
+    }
+
+    float uniform(float lo, float hi) { return lo + (hi - lo) * ((*this)() >> 8) * (1.0f / 16777216.0f); } // [lo, hi)
+
+    bool operator==(const Rng& other) const { return state == other.state && increment == other.increment; }
+
+private:
+    static const uint64_t MULTIPLIER = 6364136223846793005ULL;
+
+    uint64_t state;
+    uint64_t increment; // Odd; selects the stream
+};
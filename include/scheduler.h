@@ -0,0 +1,99 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Timer wheel driven by simulation time (microseconds, not wall clock).
+// Timers are plain data (type + arg) so the wheel can be copied with the game
+// state; the caller dispatches fired timers from advance(). Timers due in the
+// same advance fire in (due, id) order, so a replay of the same dt sequence
+// fires the same events in the same order. Only simulation events go here;
+// controllers such as bots keep their own think times (bot.h).
+
+typedef uint32_t TimerId;
+const TimerId INVALID_TIMER = 0;
+
+struct Timer {
+    TimerId id;
+    int type; // Caller-defined event type
+    int arg; // Caller-defined payload (player index, etc.)
+    uint64_t due; // Simulation time in microseconds
+    uint64_t interval; // 0 for one-shot timers
+};
+
+class Scheduler {
+public:
+    static const uint64_t SLOT_US = 4000; // 4ms per slot
+    static const size_t SLOT_COUNT = 512; // ~2s per revolution
+
+    Scheduler();
+
+    TimerId schedule(uint64_t delayUs, int type, int arg = 0);
+    TimerId scheduleRepeating(uint64_t intervalUs, int type, int arg = 0);
+    bool cancel(TimerId id); // Scans pending timers; cancelling is rare
+    void clear();
+    void reset(); // clear() and rewind to time 0 for a new match
+
+    // Moves simulation time to nowUs and fires everything due, calling
+    // handler(const Timer&) for each. The handler may schedule or cancel.
+    template <typename Handler>
+    void advance(uint64_t nowUs, Handler&& handler);
+
+    // Just the pending timers and the clock, for snapshots: a few dozen
+    // bytes instead of every slot. load() puts each timer back in the slot
+    // it came from, so the restored wheel fires exactly as the saved one.
+    struct Saved {
+        uint64_t nowUs, cursorTick;
+        TimerId nextId;
+        std::vector<Timer> timers;
+    };
+    void save(Saved& out) const; // Reuses out's buffer
+    void load(const Saved& saved);
+
+    uint64_t now() const { return nowUs; }
+    size_t pending() const { return count; }
+    uint64_t remaining(TimerId id) const; // 0 if not pending
+
+private:
+    void insert(const Timer& timer);
+    bool collectDue(size_t slot, std::vector<Timer>& out);
+    uint64_t earliestDueTick() const;
+
+    std::vector<std::vector<Timer>> slots;
+    std::vector<Timer> fired; // Scratch, reused between advances
+    uint64_t nowUs;
+    uint64_t cursorTick; // Next slot tick to visit
+    TimerId nextId;
+    size_t count;
+};
+
+template <typename Handler>
+void Scheduler::advance(uint64_t target, Handler&& handler) {
+    if (target < nowUs) return;
+    nowUs = target;
+    uint64_t nowTick = nowUs / SLOT_US;
+    while (cursorTick <= nowTick) {
+        if (count == 0) { // Idle: nothing to visit
+            cursorTick = nowTick;
+            return;
+        }
+        if (nowTick - cursorTick >= SLOT_COUNT) { // Long jump: skip empty revolutions
+            uint64_t first = earliestDueTick();
+            if (first > cursorTick) cursorTick = first < nowTick ? first : nowTick;
+        }
+        size_t slot = cursorTick % SLOT_COUNT;
+        // Repeating timers can land back in the current slot, so drain it
+        while (collectDue(slot, fired)) {
+            for (const Timer& timer : fired) {
+                if (timer.interval) {
+                    Timer next = timer;
+                    next.due += timer.interval;
+                    insert(next);
+                }
+                handler(timer);
+            }
+        }
+        if (cursorTick == nowTick) break;
+        cursorTick++;
+    }
+}
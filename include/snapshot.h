@@ -0,0 +1,100 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "game.h"
+
+// Flat snapshots of a GameState: one contiguous block that is written with a
+// memcpy per trail tile and read where it lies (a replay's buffer, an mmap,
+// a network packet) through SnapshotView, without building heap objects.
+// Anything that needs an exact copy of the state outside the process uses
+// this layout; checkpoints trade exactness of trail positions for size and
+// keep their own (checkpoint.h).
+//
+// Layout, native byte order, every section 8-byte aligned:
+//
+//   SnapshotHeader
+//   SnapshotHead[2]
+//   SnapshotGlobals
+//   SnapshotTimer[timerCount]
+//   Circle[circleCount]
+//   per player: uint32_t tileStart[TRAIL_TILE_COUNT + 1], then
+//               TrailPoint[pointCount], tile by tile in arena order
+//
+// Tile t of a player is points [tileStart[t], tileStart[t + 1]). Padding is
+// zeroed, so equal states give equal bytes.
+
+const uint32_t SNAPSHOT_MAGIC = 0x53534e4c; // "LNSS"
+const uint32_t SNAPSHOT_VERSION = 1;
+
+struct SnapshotHeader {
+    uint32_t magic, version;
+    uint64_t size; // Whole snapshot, header included
+    uint64_t hash; // Of everything after the header
+    uint32_t timerCount, circleCount;
+    uint32_t pointCount[2];
+};
+
+struct SnapshotHead {
+    Vec2 pos, direction;
+    Color color;
+    uint8_t alive, willDie, hasMoved, padding;
+    int32_t killedBy;
+    uint32_t nextSeq; // Trail cursor
+    Vec2 newestPos, newestDirection;
+};
+
+struct SnapshotGlobals {
+    uint64_t simTimeUs, roundStartUs;
+    Rng rng[RNG_STREAM_COUNT];
+    uint64_t schedulerNowUs, schedulerCursorTick;
+    uint32_t schedulerNextId;
+    TimerId spawnTimer, countdownTimer;
+    int32_t scores[2];
+    int32_t countdown;
+    uint8_t gameOver, padding[3];
+    Collectible collectible;
+};
+
+struct SnapshotTimer {
+    TimerId id;
+    int32_t type, arg, padding;
+    uint64_t due, interval;
+};
+
+void writeSnapshot(const GameState& state, std::vector<uint8_t>& out); // Replaces out's contents; reuses its buffer
+uint64_t hashSnapshot(const uint8_t* data, size_t size); // 32 bytes a step, so checking keeps up with copying
+
+// A validated snapshot in someone else's memory, which must outlive it
+class SnapshotView {
+public:
+    SnapshotView() : header(nullptr) {}
+
+    // Checks the header, that every section fits in size and that the tile
+    // tables run in order within their points; checkHash also hashes the
+    // body, for data that crossed a disk or a network. data must be 8-byte
+    // aligned (malloc, vectors and mmap are). False leaves the view empty.
+    bool open(const uint8_t* data, size_t size, bool checkHash = true);
+    bool isOpen() const { return header != nullptr; }
+    size_t size() const { return header->size; }
+
+    const SnapshotHead& head(int player) const { return heads[player]; }
+    const SnapshotGlobals& globals() const { return *global; }
+    const SnapshotTimer* timers() const { return timerList; }
+    uint32_t timerCount() const { return header->timerCount; }
+    const Circle* circles() const { return circleList; }
+    uint32_t circleCount() const { return header->circleCount; }
+    uint32_t pointCount(int player) const { return header->pointCount[player]; }
+    const TrailPoint* tile(int player, int index, size_t& count) const;
+
+    void restore(GameState& state) const; // Copies it into state, reusing state's buffers
+
+private:
+    const SnapshotHeader* header;
+    const SnapshotHead* heads;
+    const SnapshotGlobals* global;
+    const SnapshotTimer* timerList;
+    const Circle* circleList;
+    const uint32_t* tileStart[2];
+    const TrailPoint* points[2];
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "game.h"
+#include "render.h"
+
+class JobSystem;
+
+// CPU rasterizer for RenderLists, for targets with weak or no GL and for
+// machines without a GPU. Items are binned into screen tiles in submission
+// order, then each tile is filled on its own (in parallel with a JobSystem),
+// so tiles never share pixels and the image does not depend on the thread
+// count. Coverage follows GL's pixel-center rule, so squares match the GL
+// path exactly; circles are true circles rather than 360-gons.
+//
+// The framebuffer is ARGB8888, WIDTH x HEIGHT, ready for SDL_UpdateTexture.
+
+class SoftRenderer {
+public:
+    static const int TILE_SIZE = 64;
+    static const int TILES_X = (WIDTH + TILE_SIZE - 1) / TILE_SIZE;
+    static const int TILES_Y = (HEIGHT + TILE_SIZE - 1) / TILE_SIZE;
+
+    SoftRenderer();
+
+    void render(RenderList& list, JobSystem* jobs = nullptr); // Clears to black, then draws; sorts the list
+    const uint32_t* pixels() const { return framebuffer.data(); }
+    int pitch() const { return WIDTH * sizeof(uint32_t); }
+    bool writePpm(const std::string& path) const;
+
+private:
+    struct BinEntry {
+        uint32_t item;
+        uint32_t color; // ARGB; the top byte holds the DrawShape instead of alpha
+    };
+
+    void rasterTile(const RenderList& list, int tile);
+
+    std::vector<uint32_t> framebuffer;
+    std::vector<std::vector<BinEntry>> bins; // Per tile, in submission order
+};
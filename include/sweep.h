@@ -0,0 +1,23 @@
+#pragma once
+#include <string>
+
+// Parameter sweep over headless bot matches. The spec file uses the config
+// syntax; a config key given one value is fixed, two or three values
+// ("min max [steps]") make it a swept parameter. Values have to stay within
+// the key's range (configRange), as in the config file:
+//
+//   MODE = grid            # or random
+//   SAMPLES = 200          # random mode: parameter points to draw
+//   MATCHES = 8            # bot matches per point
+//   ROUNDS = 5             # rounds per match
+//   SEED = 1
+//   TICK_RATE = 60         # simulation ticks per second
+//   MAX_ROUND_SECONDS = 180
+//   PLAYER_SPEED = 150 250 5
+//   CIRCLE_RADIUS = 30 60
+//   POLICY = bot.lnmp      # optional: player 2 plays this network (policy.h)
+//
+// Results are appended to a TSV table, one line per finished point, and
+// flushed as they complete; rerunning the same spec against the same output
+// skips points already in the file, so long sweeps resume after a restart.
+int runSweep(const std::string& specPath, const std::string& outPath, int threads);
@@ -0,0 +1,81 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "profiler.h"
+#include "queues.h"
+#ifndef LINES_NO_THREADS
+#include <thread>
+#endif
+
+// Newline-JSON telemetry for the ops dashboard. Any thread (game, sim) pushes
+// fixed-size records into a lock-free MPSC queue; a background thread formats and
+// writes them to a file or a Unix socket ("unix:/path"). push() never blocks:
+// when the writer falls behind, records are dropped and counted.
+// Disabled on LINES_NO_THREADS builds, where the writer would have to run on
+// the game thread.
+
+enum TelemetryType {
+    TELEMETRY_FRAME,
+    TELEMETRY_ROUND,
+    TELEMETRY_STUTTER, // Frame over the stutter threshold, with its zone times
+    TELEMETRY_HISTOGRAM // Periodic frame/tick percentiles
+};
+
+struct TelemetryRecord {
+    uint8_t type;
+    int8_t winner; // TELEMETRY_ROUND: player index, -1 for a draw
+    int8_t killedBy[2]; // TELEMETRY_ROUND: HitSource per player
+    uint64_t timeUs; // Simulation time
+    float frameMs; // TELEMETRY_FRAME, TELEMETRY_STUTTER: wall time of the frame
+    float tickMs; // TELEMETRY_FRAME: time spent in stepGame
+    float roundSeconds; // TELEMETRY_ROUND
+    float zoneMs[PROFILE_ZONE_COUNT]; // TELEMETRY_STUTTER
+    bool gpu; // TELEMETRY_FRAME: gpuMs is set
+    float gpuMs[GPU_ZONE_COUNT]; // TELEMETRY_FRAME: latest frame the GPU timers resolved
+    bool gl; // TELEMETRY_FRAME: glStats is set
+    DrawStats glStats; // TELEMETRY_FRAME
+    uint32_t contextSwitches; // TELEMETRY_FRAME, TELEMETRY_STUTTER: involuntary, during the frame
+    float percentiles[2][4]; // TELEMETRY_HISTOGRAM: [frame, tick][p50, p99, p99.9, max] in ms
+    uint32_t trailPoints[2];
+    uint32_t circles;
+    int32_t scores[2];
+};
+
+class Telemetry {
+public:
+    static const size_t CAPACITY = 4096; // Records; about a minute of frames at 60fps
+
+    Telemetry();
+    ~Telemetry() { close(); }
+    Telemetry(const Telemetry&) = delete;
+    Telemetry& operator=(const Telemetry&) = delete;
+
+    bool open(const std::string& target); // File path or "unix:/path/to/socket"
+    void close(); // Drains what is queued (a socket gets 200ms to take it), then stops the writer
+    bool isOpen() const { return opened; }
+
+    bool push(const TelemetryRecord& record); // Any thread; false if dropped
+    uint64_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+
+private:
+    void writerLoop();
+    bool connectTarget();
+    long writeSome(const char* data, size_t size); // Bytes written, short when a socket is full; -1 on error
+
+    MpscQueue<TelemetryRecord> queue;
+    alignas(CACHE_LINE) std::atomic<uint64_t> droppedCount;
+    std::atomic<bool> running;
+    bool opened;
+    std::string target;
+    int fd;
+#ifndef LINES_NO_THREADS
+    std::thread writer;
+#endif
+};
+
+// Frame record, plus a stutter record when this frame stuttered
+void pushFrameTelemetry(Telemetry& telemetry, const GameState& state, const Profiler& profiler, bool stutter);
+void pushRoundTelemetry(Telemetry& telemetry, const GameState& state); // From the thread that saw the round end
+void pushHistogramTelemetry(Telemetry& telemetry, const GameState& state, const Profiler& profiler);
@@ -0,0 +1,148 @@
+#include "affinity.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#if defined(__linux__) && !defined(__EMSCRIPTEN__) && !defined(LINES_NO_THREADS)
+#define LINES_THREAD_POLICY
+#include <cerrno>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+struct ThreadPolicy {
+    std::vector<int> cpus;
+    bool fifo = false;
+    int priority = 0; // SCHED_FIFO priority when fifo
+    bool nice = false;
+    int niceValue = 0;
+};
+
+const long MAX_CPUS = 1024; // CPU_SETSIZE on glibc
+
+ThreadPolicy policies[THREAD_ROLE_COUNT]; // Written before any thread starts
+std::atomic<bool> warned[THREAD_ROLE_COUNT];
+
+const char* const ROLE_NAMES[THREAD_ROLE_COUNT] = {"main", "sim", "workers"};
+
+bool splitRole(const std::string& arg, ThreadRole& role, std::string& value) {
+    size_t eq = arg.find('=');
+    if (eq == std::string::npos) return false;
+    std::string name = arg.substr(0, eq);
+    value = arg.substr(eq + 1);
+    if (name == "input" || name == "render") name = "main"; // Both run on the main thread
+    if (name == "worker") name = "workers";
+    for (int i = 0; i < THREAD_ROLE_COUNT; ++i) {
+        if (name == ROLE_NAMES[i]) {
+            role = static_cast<ThreadRole>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// "0,2-3" -> {0, 2, 3}
+bool parseCpuList(const std::string& text, std::vector<int>& cpus) {
+    cpus.clear();
+    const char* p = text.c_str();
+    while (*p) {
+        char* end;
+        long first = std::strtol(p, &end, 10);
+        if (end == p || first < 0) return false;
+        long last = first;
+        if (*end == '-') {
+            p = end + 1;
+            last = std::strtol(p, &end, 10);
+            if (end == p || last < first) return false;
+        }
+        if (last >= MAX_CPUS) return false;
+        for (long cpu = first; cpu <= last; ++cpu) cpus.push_back(static_cast<int>(cpu));
+        if (*end == ',') end++;
+        else if (*end) return false;
+        p = end;
+    }
+    return !cpus.empty();
+}
+
+#ifdef LINES_THREAD_POLICY
+void warnOnce(ThreadRole role, const char* what, int error) {
+    if (warned[role].exchange(true)) return;
+    std::fprintf(stderr, "threads: %s: %s (%s), using default scheduling\n", ROLE_NAMES[role], what, std::strerror(error));
+}
+#endif
+
+} // namespace
+
+bool parseAffinity(const std::string& arg) {
+    ThreadRole role;
+    std::string value;
+    return splitRole(arg, role, value) && parseCpuList(value, policies[role].cpus);
+}
+
+bool parsePriority(const std::string& arg) {
+    ThreadRole role;
+    std::string value;
+    if (!splitRole(arg, role, value)) return false;
+    ThreadPolicy& policy = policies[role];
+    char* end;
+    if (value.compare(0, 5, "fifo:") == 0) {
+        long priority = std::strtol(value.c_str() + 5, &end, 10);
+        if (*end || priority < 1 || priority > 99) return false;
+        policy.fifo = true;
+        policy.priority = static_cast<int>(priority);
+        return true;
+    }
+    if (value.compare(0, 5, "nice:") == 0) {
+        long nice = std::strtol(value.c_str() + 5, &end, 10);
+        if (*end || nice < -20 || nice > 19) return false;
+        policy.nice = true;
+        policy.niceValue = static_cast<int>(nice);
+        return true;
+    }
+    return false;
+}
+
+void applyThreadRole(ThreadRole role, int index) {
+    const ThreadPolicy& policy = policies[role];
+#ifdef LINES_THREAD_POLICY
+    if (!policy.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (role == THREAD_WORKER) {
+            CPU_SET(policy.cpus[index % policy.cpus.size()], &set);
+        } else {
+            for (int cpu : policy.cpus) CPU_SET(cpu, &set);
+        }
+        int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (error) warnOnce(role, "cannot pin", error);
+    }
+    bool nice = policy.nice;
+    int niceValue = policy.niceValue;
+    if (policy.fifo) {
+        sched_param param;
+        param.sched_priority = policy.priority;
+        int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (error == EPERM) {
+            nice = true; // No realtime rights: the best a normal user may get
+            niceValue = FALLBACK_NICE;
+        } else if (error) {
+            warnOnce(role, "cannot set SCHED_FIFO", error);
+        }
+    }
+    // Linux applies nice per thread when given the thread id
+    if (nice && setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), niceValue) != 0) {
+        warnOnce(role, policy.fifo ? "no SCHED_FIFO and cannot renice" : "cannot renice", errno);
+    }
+#else
+    (void)index;
+    if ((!policy.cpus.empty() || policy.fifo || policy.nice) && !warned[role].exchange(true)) {
+        std::fprintf(stderr, "threads: %s: pinning and priority not supported on this platform\n", ROLE_NAMES[role]);
+    }
+#endif
+}
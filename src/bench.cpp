@@ -0,0 +1,956 @@
+#include "bench.h"
+#include "bot.h"
+#include "checkpoint.h"
+#include "dataset.h"
+#include "env.h"
+#include "game.h"
+#include "jobs.h"
+#include "observe.h"
+#include "pipeline.h"
+#include "policy.h"
+#include "rewind.h"
+#include "snapshot.h"
+#include "queues.h"
+#include "replay.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <vector>
+#ifndef LINES_NO_THREADS
+#include <deque>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace {
+
+struct EraseScenario {
+    const char* name;
+    int circles;
+    int trailPoints; // Per player
+};
+
+// A typical late round, then arenas well past anything a match reaches
+const EraseScenario ERASE_SCENARIOS[] = {
+    {"late-round", 24, 20000},
+    {"long-trails", 64, 200000},
+    {"swarm", 512, 100000},
+};
+
+const int ERASE_ITERATIONS = 40;
+
+double nowMs() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t hashTrails(const GameState& state) {
+    uint64_t hash = 1469598103934665603ULL; // FNV-1a over what survived, in tile order
+    for (const auto& player : state.players) {
+        for (int t = 0; t < TRAIL_TILE_COUNT; ++t) {
+            for (const auto& point : player.trail.tile(t)) {
+                hash = (hash ^ point.seq) * 1099511628211ULL;
+            }
+        }
+    }
+    return hash;
+}
+
+// Players wander the arena like long-lived bots; circles are scattered with
+// their usual speed so each iteration erases a fresh set of points
+void buildEraseArena(GameState& state, const GameConfig& config, const EraseScenario& scenario) {
+    newGame(state, config, 1);
+    Rng& rng = state.rng[RNG_CIRCLES];
+    for (auto& player : state.players) {
+        float angle = atan2(player.direction.y, player.direction.x);
+        Vec2 pos = player.pos;
+        for (int i = 0; i < scenario.trailPoints; ++i) {
+            angle += rng.uniform(-0.08f, 0.08f);
+            Vec2 next = pos + Vec2(cos(angle), sin(angle)) * 3.0f;
+            if (next.x < 0 || next.x > WIDTH || next.y < 0 || next.y > HEIGHT) {
+                angle += static_cast<float>(M_PI); // Bounce off the wall
+                continue;
+            }
+            pos = next;
+            player.trail.push(pos);
+        }
+    }
+    state.circles.clear();
+    for (int i = 0; i < scenario.circles; ++i) {
+        float x = rng.uniform(config.circleRadius, WIDTH - config.circleRadius);
+        float y = rng.uniform(config.circleRadius, HEIGHT - config.circleRadius);
+        state.circles.push_back(Circle{Vec2(x, y), Vec2(), config.circleRadius});
+    }
+}
+
+int benchErase(int maxThreads) {
+    GameConfig config;
+    std::printf("%-12s %8s %10s %8s %10s  %s\n", "scenario", "threads", "ms/erase", "speedup", "points", "hash");
+    for (const auto& scenario : ERASE_SCENARIOS) {
+        GameState arena;
+        buildEraseArena(arena, config, scenario);
+        double baseMs = 0;
+        uint64_t baseHash = 0;
+        for (int threads = 1;; threads = std::min(threads * 2, maxThreads)) {
+            JobSystem jobs(threads);
+            double totalMs = 0;
+            uint64_t hash = 0;
+            size_t points = 0;
+            GameState state;
+            for (int i = 0; i < ERASE_ITERATIONS; ++i) {
+                state = arena;
+                // Shift the circles each iteration so every run erases something
+                for (auto& circle : state.circles) circle.pos.x = std::fmod(circle.pos.x + i * 37.0f, WIDTH - 2 * circle.radius) + circle.radius;
+                double start = nowMs();
+                eraseTrails(state, &jobs);
+                totalMs += nowMs() - start;
+                hash = (hash ^ hashTrails(state)) * 1099511628211ULL;
+                points = state.players[0].trail.size() + state.players[1].trail.size();
+            }
+            double ms = totalMs / ERASE_ITERATIONS;
+            if (threads == 1) {
+                baseMs = ms;
+                baseHash = hash;
+            }
+            std::printf("%-12s %8d %10.3f %7.2fx %10zu  %016llx%s\n", scenario.name, jobs.threadCount(), ms, baseMs / ms, points,
+                        static_cast<unsigned long long>(hash), hash == baseHash ? "" : "  MISMATCH");
+            if (hash != baseHash) return 1;
+            if (threads >= maxThreads || jobs.threadCount() < threads) break;
+        }
+    }
+    return 0;
+}
+
+const int RUN_AHEAD_ITERATIONS = 200;
+const double FRAME_BUDGET_MS = 1000.0 / 60;
+
+// Everything a tick can change, to check a prediction left the real arena alone
+uint64_t hashState(const GameState& state) {
+    uint64_t hash = hashTrails(state);
+    auto mix = [&hash](uint64_t value) { hash = (hash ^ value) * 1099511628211ULL; };
+    for (const auto& player : state.players) {
+        mix(static_cast<uint64_t>(player.pos.x * 1000) << 32 ^ static_cast<uint64_t>(player.pos.y * 1000));
+        mix(player.alive | player.willDie << 1 | player.hasMoved << 2);
+    }
+    for (const auto& circle : state.circles) mix(static_cast<uint64_t>(circle.pos.x * 1000) << 32 ^ static_cast<uint64_t>(circle.pos.y * 1000));
+    mix(state.simTimeUs);
+    mix(state.gameOver);
+    return hash;
+}
+
+// Clears a pocket around each head so the round stays live through the
+// next few ticks; a dead player's ticks cost next to nothing
+void clearAroundHeads(GameState& arena) {
+    for (auto& player : arena.players) {
+        Vec2 head = player.pos;
+        auto nearHead = [head](const Vec2& pos, float radius) {
+            float dx = pos.x - head.x, dy = pos.y - head.y;
+            return dx * dx + dy * dy < radius * radius;
+        };
+        for (auto& other : arena.players) {
+            for (int t = 0; t < TRAIL_TILE_COUNT; ++t) {
+                other.trail.eraseIf(t, [&](const TrailPoint& point) { return !other.trail.recent(point, SELF_TRAIL_SKIP) && nearHead(point.pos, 40.0f); });
+            }
+        }
+        arena.circles.erase(std::remove_if(arena.circles.begin(), arena.circles.end(),
+                                           [&](const Circle& circle) { return nearHead(circle.pos, 200.0f); }),
+                            arena.circles.end());
+    }
+}
+
+// What SimStage does each frame with --run-ahead: copy the arena into a warm
+// scratch state, then step the copy N ticks with one frame's input
+int benchRunAhead(int maxThreads) {
+    GameConfig config;
+    JobSystem jobs(maxThreads);
+    CpuCollision collision;
+    const PlayerInput inputs[2] = {{12000, 0}, {0, 9000}}; // Both steering, so collision is live
+    const float dt = 1.0f / 60;
+    int failures = 0;
+    std::printf("%-12s %8s %9s %9s %4s %10s %8s\n", "scenario", "points", "save_us", "tick_ms", "N", "frame_ms", "budget");
+    for (const auto& scenario : ERASE_SCENARIOS) {
+        GameState arena;
+        buildEraseArena(arena, config, scenario);
+        clearAroundHeads(arena);
+        uint64_t arenaHash = hashState(arena);
+        GameState ahead = arena; // Warm, as SimStage's scratch is after the first frame
+
+        double start = nowMs();
+        for (int i = 0; i < RUN_AHEAD_ITERATIONS; ++i) ahead = arena;
+        double saveUs = (nowMs() - start) * 1000.0 / RUN_AHEAD_ITERATIONS;
+
+        // Reference: the real arena stepped the same way, hashed per tick
+        uint64_t expected[SimStage::MAX_RUN_AHEAD + 1];
+        GameState reference = arena;
+        start = nowMs();
+        for (int n = 1; n <= SimStage::MAX_RUN_AHEAD; ++n) {
+            stepGame(reference, config, inputs, dt, collision, &jobs);
+            expected[n] = hashState(reference);
+        }
+        double tickMs = (nowMs() - start) / SimStage::MAX_RUN_AHEAD;
+
+        for (int n = 1; n <= SimStage::MAX_RUN_AHEAD; ++n) {
+            double totalMs = 0;
+            bool match = true;
+            for (int i = 0; i < RUN_AHEAD_ITERATIONS / 10; ++i) {
+                start = nowMs();
+                ahead = arena;
+                for (int t = 0; t < n; ++t) stepGame(ahead, config, inputs, dt, collision, &jobs);
+                totalMs += nowMs() - start;
+                match = match && hashState(ahead) == expected[n];
+            }
+            double ms = totalMs / (RUN_AHEAD_ITERATIONS / 10);
+            bool intact = hashState(arena) == arenaHash;
+            std::printf("%-12s %8zu %9.1f %9.3f %4d %10.3f %7.1f%%%s%s%s\n", scenario.name, arena.players[0].trail.size() + arena.players[1].trail.size(),
+                        saveUs, tickMs, n, ms, 100.0 * ms / FRAME_BUDGET_MS, ahead.gameOver ? "  (round over)" : "", match ? "" : "  MISMATCH",
+                        intact ? "" : "  ARENA CHANGED");
+            if (!match || !intact) failures++;
+        }
+    }
+    return failures ? 1 : 0;
+}
+
+const int REWIND_TICKS = 600; // Ten seconds at 60Hz, the default --rewind
+
+// Six seconds of ticks on each stress arena into a RewindRing: capture cost
+// on delta and keyframe ticks against copying the whole state, bytes held,
+// and the mean and slowest view (up to a full group of deltas). Heads start
+// in open lanes without input, which leaves them untouchable, and run the
+// whole time while the circles keep erasing. Every tick the ring holds must
+// view back to what the arena was.
+int benchRewind(int maxThreads) {
+    GameConfig config;
+    JobSystem jobs(maxThreads);
+    CpuCollision collision;
+    const PlayerInput inputs[2] = {{0, 0}, {0, 0}};
+    const float dt = 1.0f / 60;
+    int failures = 0;
+    std::printf("%-12s %8s %9s %9s %9s %10s %10s %9s %9s\n", "scenario", "points", "copy_us", "delta_us", "key_us", "delta_B", "ring_KB", "view_us", "view_max");
+    for (const auto& scenario : ERASE_SCENARIOS) {
+        GameState state;
+        buildEraseArena(state, config, scenario);
+        for (int i = 0; i < 2; ++i) {
+            state.players[i].pos = Vec2(100, HEIGHT / 3.0f * (i + 1));
+            state.players[i].direction = Vec2(1, 0);
+        }
+        RewindRing ring(REWIND_TICKS);
+        GameState start = state, copy = state;
+        std::vector<uint64_t> hashes;
+        double copyMs = 0, deltaMs = 0, keyMs = 0;
+        int keys = 0;
+        // Twice, timing the second pass, when the ring's buffers are warm as
+        // they are once it has wrapped; 360 ticks leave the heads short of
+        // the far wall
+        for (int pass = 0; pass < 2; ++pass) {
+            state = start;
+            ring.clear();
+            hashes.clear();
+            copyMs = deltaMs = keyMs = 0;
+            keys = 0;
+            for (int tick = 0; tick < 360; ++tick) {
+                stepGame(state, config, inputs, dt, collision, &jobs);
+                double begin = nowMs();
+                copy = state;
+                copyMs += nowMs() - begin;
+                begin = nowMs();
+                ring.capture(state);
+                double ms = nowMs() - begin;
+                if (tick % RewindRing::KEYFRAME_INTERVAL == 0) {
+                    keyMs += ms;
+                    keys++;
+                } else {
+                    deltaMs += ms;
+                }
+                hashes.push_back(hashState(state));
+            }
+        }
+        int ticks = static_cast<int>(hashes.size());
+        size_t bytes = ring.bytes();
+        size_t keyBytes = sizeof(GameState) + (state.players[0].trail.size() + state.players[1].trail.size()) * sizeof(TrailPoint);
+        double deltaBytes = (bytes - keys * static_cast<double>(keyBytes)) / (ticks - keys); // Keyframes sized as the last state
+
+        double viewMs = 0, viewMaxMs = 0;
+        for (int back = 0; back < ring.size(); ++back) {
+            double begin = nowMs();
+            ring.view(back, copy);
+            double ms = nowMs() - begin;
+            viewMs += ms;
+            viewMaxMs = std::max(viewMaxMs, ms);
+            if (hashState(copy) != hashes[ticks - 1 - back]) failures++;
+        }
+        std::printf("%-12s %8zu %9.1f %9.1f %9.1f %10.0f %10zu %9.1f %9.1f%s\n", scenario.name, state.players[0].trail.size() + state.players[1].trail.size(),
+                    copyMs * 1000 / ticks, deltaMs * 1000 / (ticks - keys), keyMs * 1000 / keys, deltaBytes, bytes / 1024, viewMs * 1000 / ring.size(),
+                    viewMaxMs * 1000, failures ? "  MISMATCH" : "");
+    }
+    return failures ? 1 : 0;
+}
+
+const int CHECKPOINT_ITERATIONS = 20;
+const char* const CHECKPOINT_BENCH_PATH = "bench.checkpoint";
+
+// Every point's seq and position, in the order laid, for comparing a trail
+// with its decoded copy
+std::vector<TrailPoint> laidPoints(const Trail& trail) {
+    std::vector<TrailPoint> points;
+    for (int t = 0; t < TRAIL_TILE_COUNT; ++t) points.insert(points.end(), trail.tile(t).begin(), trail.tile(t).end());
+    std::sort(points.begin(), points.end(), [](const TrailPoint& a, const TrailPoint& b) { return a.seq < b.seq; });
+    return points;
+}
+
+// A checkpoint of each stress arena: encoded size against the state in
+// memory, encode and decode time, what submit() costs the sim thread (the
+// copy) and how long the writer takes to land the file. Checks a decoded
+// checkpoint encodes back to the same bytes, every point comes back within
+// half a step of the 1/256 pixel grid, and a torn or corrupted file is refused.
+int benchCheckpoint() {
+    GameConfig config;
+    int failures = 0;
+    std::printf("%-12s %8s %9s %9s %8s %9s %9s %9s %9s\n", "scenario", "points", "state_KB", "file_KB", "B/point", "encode_ms", "decode_ms", "submit_us",
+                "write_ms");
+    std::vector<uint8_t> data, again;
+    for (const auto& scenario : ERASE_SCENARIOS) {
+        GameState state, decoded;
+        buildEraseArena(state, config, scenario);
+        size_t points = state.players[0].trail.size() + state.players[1].trail.size();
+
+        double start = nowMs();
+        for (int i = 0; i < CHECKPOINT_ITERATIONS; ++i) encodeCheckpoint(state, data);
+        double encodeMs = (nowMs() - start) / CHECKPOINT_ITERATIONS;
+        start = nowMs();
+        bool ok = true;
+        for (int i = 0; i < CHECKPOINT_ITERATIONS; ++i) ok = decodeCheckpoint(data.data(), data.size(), decoded) && ok;
+        double decodeMs = (nowMs() - start) / CHECKPOINT_ITERATIONS;
+
+        encodeCheckpoint(decoded, again);
+        ok = ok && again == data;
+        for (int i = 0; i < 2; ++i) {
+            std::vector<TrailPoint> before = laidPoints(state.players[i].trail), after = laidPoints(decoded.players[i].trail);
+            ok = ok && before.size() == after.size();
+            for (size_t p = 0; ok && p < before.size(); ++p) {
+                ok = before[p].seq == after[p].seq && std::fabs(before[p].pos.x - after[p].pos.x) <= 0.5f / 256 &&
+                     std::fabs(before[p].pos.y - after[p].pos.y) <= 0.5f / 256;
+            }
+        }
+        ok = ok && !decodeCheckpoint(data.data(), data.size() - 1, decoded); // Torn
+        again = data;
+        again[again.size() / 2] ^= 1;
+        ok = ok && !decodeCheckpoint(again.data(), again.size(), decoded); // Bit flip
+
+        double submitMs = 0, writeMs = 0;
+        {
+            CheckpointWriter writer(CHECKPOINT_BENCH_PATH);
+            for (int i = 0; i < CHECKPOINT_ITERATIONS; ++i) {
+                uint64_t written = writer.written();
+                start = nowMs();
+                writer.submit(state);
+                submitMs += nowMs() - start;
+                while (writer.written() == written) {
+#ifndef LINES_NO_THREADS
+                    std::this_thread::yield();
+#endif
+                }
+                writeMs += nowMs() - start;
+            }
+            ok = ok && loadCheckpoint(CHECKPOINT_BENCH_PATH, decoded);
+            encodeCheckpoint(decoded, again);
+            ok = ok && again == data;
+            writer.discard();
+        }
+        size_t stateBytes = sizeof(GameState) + points * sizeof(TrailPoint) + state.circles.size() * sizeof(Circle);
+        std::printf("%-12s %8zu %9zu %9zu %8.2f %9.3f %9.3f %9.1f %9.3f%s\n", scenario.name, points, stateBytes / 1024, data.size() / 1024,
+                    static_cast<double>(data.size()) / points, encodeMs, decodeMs, submitMs * 1000 / CHECKPOINT_ITERATIONS, writeMs / CHECKPOINT_ITERATIONS,
+                    ok ? "" : "  MISMATCH");
+        if (!ok) failures++;
+    }
+    return failures ? 1 : 0;
+}
+
+const int SNAPSHOT_ITERATIONS = 20;
+
+// Throughput of flat snapshots per MB of trail data (12 bytes a point): write,
+// open with and without the hash, and restore into a warm state. Checks a
+// restored state writes back the same bytes and hashes as the original, and
+// that a flipped bit, a short buffer and a misaligned one are refused.
+int benchSnapshot() {
+    GameConfig config;
+    int failures = 0;
+    std::printf("%-12s %8s %9s %9s %10s %10s %9s %10s\n", "scenario", "points", "trail_MB", "snap_KB", "write_MB/s", "check_MB/s", "open_us", "restore_MB/s");
+    std::vector<uint8_t> data, again;
+    for (const auto& scenario : ERASE_SCENARIOS) {
+        GameState state, restored;
+        buildEraseArena(state, config, scenario);
+        size_t points = state.players[0].trail.size() + state.players[1].trail.size();
+        double trailMb = points * sizeof(TrailPoint) / (1024.0 * 1024.0);
+        writeSnapshot(state, data); // Warm the buffer, as a reused one is
+
+        double start = nowMs();
+        for (int i = 0; i < SNAPSHOT_ITERATIONS; ++i) writeSnapshot(state, data);
+        double writeMs = (nowMs() - start) / SNAPSHOT_ITERATIONS;
+        SnapshotView view;
+        bool ok = true;
+        start = nowMs();
+        for (int i = 0; i < SNAPSHOT_ITERATIONS; ++i) ok = view.open(data.data(), data.size()) && ok;
+        double checkMs = (nowMs() - start) / SNAPSHOT_ITERATIONS;
+        start = nowMs();
+        for (int i = 0; i < SNAPSHOT_ITERATIONS; ++i) ok = view.open(data.data(), data.size(), false) && ok;
+        double openMs = (nowMs() - start) / SNAPSHOT_ITERATIONS;
+        restored = state;
+        start = nowMs();
+        for (int i = 0; i < SNAPSHOT_ITERATIONS; ++i) view.restore(restored);
+        double restoreMs = (nowMs() - start) / SNAPSHOT_ITERATIONS;
+
+        writeSnapshot(restored, again);
+        ok = ok && again == data && hashState(restored) == hashState(state);
+        again[again.size() / 2] ^= 1;
+        ok = ok && !view.open(again.data(), again.size());
+        ok = ok && !view.open(data.data(), data.size() - 8, false);
+        std::vector<uint8_t> shifted(data.size() + 1);
+        std::copy(data.begin(), data.end(), shifted.begin() + 1);
+        ok = ok && !view.open(shifted.data() + 1, data.size(), false);
+        std::printf("%-12s %8zu %9.2f %9zu %10.0f %10.0f %9.1f %10.0f%s\n", scenario.name, points, trailMb, data.size() / 1024, trailMb * 1000 / writeMs,
+                    trailMb * 1000 / checkMs, openMs * 1000, trailMb * 1000 / restoreMs, ok ? "" : "  MISMATCH");
+        if (!ok) failures++;
+    }
+    return failures ? 1 : 0;
+}
+
+const int ENV_BATCH = 256;
+const int ENV_STEPS = 300;
+const int ENV_HOLD_STEPS = 10; // Random actions are held this long, like a steering player
+
+// Match ticks per second through VecEnv at 1, 2, 4 ... maxThreads, with
+// random held actions. Every thread count must produce the same
+// observations, rewards and dones.
+int benchEnv(int maxThreads) {
+    GameConfig config;
+    std::vector<PlayerInput> actions(ENV_BATCH * 2);
+    uint64_t expected = 0;
+    int failures = 0;
+    std::printf("%8s %6s %6s %12s %10s %7s  %s\n", "threads", "batch", "steps", "steps/s", "us/step", "dones", "hash");
+    for (int threads = 1;; threads = std::min(threads * 2, maxThreads)) {
+        JobSystem jobs(threads);
+        VecEnv env(config, jobs);
+        env.reset(ENV_BATCH, 1);
+        Rng rng(1, 0);
+        uint64_t hash = 1469598103934665603ULL;
+        int dones = 0;
+        double start = nowMs();
+        for (int step = 0; step < ENV_STEPS; ++step) {
+            if (step % ENV_HOLD_STEPS == 0) {
+                for (auto& action : actions) {
+                    uint32_t draw = rng();
+                    int16_t amount = static_cast<int16_t>(draw & 0x7fff);
+                    action = draw & 0x10000 ? PlayerInput{amount, 0} : PlayerInput{0, amount};
+                }
+            }
+            EnvStep result = env.step(actions.data());
+            for (int i = 0; i < ENV_BATCH; ++i) {
+                dones += result.dones[i];
+                hash = (hash ^ result.dones[i] ^ static_cast<uint64_t>(static_cast<int>(result.rewards[i * 2])) << 8) * 1099511628211ULL;
+            }
+            for (int i = 0; i < ENV_BATCH * 2 * ENV_OBS_SIZE; i += ENV_OBS_SIZE + 1) { // A spread of observation values
+                uint32_t bits;
+                std::memcpy(&bits, &result.observations[i], sizeof(bits));
+                hash = (hash ^ bits) * 1099511628211ULL;
+            }
+        }
+        double ms = nowMs() - start;
+        if (threads == 1) expected = hash;
+        bool match = hash == expected;
+        if (!match) failures++;
+        std::printf("%8d %6d %6d %12.0f %10.1f %7d  %016llx%s\n", threads, ENV_BATCH, ENV_STEPS, ENV_BATCH * ENV_STEPS / (ms / 1000.0), ms * 1000 / ENV_STEPS,
+                    dones, static_cast<unsigned long long>(hash), match ? "" : "  MISMATCH");
+        if (threads >= maxThreads) break;
+    }
+    return failures ? 1 : 0;
+}
+
+const uint64_t RNG_DRAWS = 20000000;
+const int RNG_COPIES = 200000;
+volatile uint32_t rngSink; // Where the draws end up, so none are optimized out
+
+// Millions of outputs per second; sink keeps the draws from being optimized out
+template <typename Draw>
+double drawRate(Draw draw, uint32_t& sink) {
+    double start = nowMs();
+    for (uint64_t i = 0; i < RNG_DRAWS; ++i) sink += draw();
+    return RNG_DRAWS / ((nowMs() - start) * 1000.0);
+}
+
+// Nanoseconds to copy a generator into a snapshot slot (and draw once from
+// an older one)
+template <typename Gen>
+double copyNs(const Gen& source, uint32_t& sink) {
+    std::vector<Gen> slots(64, source);
+    double start = nowMs();
+    for (int i = 0; i < RNG_COPIES; ++i) {
+        slots[i & 63] = source;
+        sink += slots[(i + 32) & 63]();
+    }
+    return (nowMs() - start) * 1e6 / RNG_COPIES;
+}
+
+// The game's generator against the std::mt19937 it replaced: state size,
+// snapshot copy cost, throughput, and a check that advance() lands where
+// drawing one output at a time does
+const int OBSERVE_HEADS = 64; // Heads sampled per batch, over one map
+const int OBSERVE_ITERATIONS = 20;
+
+int benchObserve() {
+    GameConfig config;
+    int failures = 0;
+
+    // The SIMD filter against the plain average, on a width that leaves a scalar tail
+    const int testWidth = 2 * 37, testHeight = 6;
+    std::vector<uint8_t> src(testWidth * testHeight), filtered(testWidth / 2 * testHeight / 2);
+    Rng rng(7, 0);
+    for (auto& value : src) value = static_cast<uint8_t>(rng());
+    boxFilter2x2(src.data(), testWidth, testHeight, filtered.data());
+    for (int y = 0; y < testHeight / 2; ++y) {
+        for (int x = 0; x < testWidth / 2; ++x) {
+            const uint8_t* a = &src[2 * y * testWidth + 2 * x];
+            int expected = (a[0] + a[1] + a[testWidth] + a[testWidth + 1] + 2) >> 2;
+            if (filtered[y * testWidth / 2 + x] != expected) failures++;
+        }
+    }
+    if (failures) std::printf("boxFilter2x2 differs from the scalar average in %d cells\n", failures);
+
+    OccupancyMap map;
+    std::vector<float> floats(static_cast<size_t>(OBSERVE_HEADS) * OBS_GRID_CELLS);
+    std::vector<uint8_t> bytes(floats.size());
+
+    // Nose against the top wall, facing it: the front rows are solid wall
+    GameState empty;
+    newGame(empty, config, 1);
+    empty.circles.clear();
+    for (auto& player : empty.players) player.trail.clear();
+    map.build(empty);
+    ObservationHead facingWall{&map, Vec2(WIDTH / 2.0f, 4.0f), Vec2(0.0f, -1.0f)};
+    observeHeads(&facingWall, 1, floats.data());
+    bool wallAhead = true;
+    for (int i = 0; i < OBS_GRID * (OBS_GRID / 2 - 2); ++i) wallAhead &= floats[i] == 1.0f;
+    bool clearBehind = floats[(OBS_GRID - 1) * OBS_GRID + OBS_GRID / 2] == 0.0f;
+    if (!wallAhead || !clearBehind) {
+        std::printf("A head facing the wall sees %s ahead and %s behind\n", wallAhead ? "wall" : "gaps", clearBehind ? "space" : "blocked cells");
+        failures++;
+    }
+
+    std::printf("%-12s %10s %10s %12s %12s  %s\n", "scenario", "build ms", "filter us", "float us/hd", "byte us/hd", "check");
+    for (const auto& scenario : ERASE_SCENARIOS) {
+        GameState arena;
+        buildEraseArena(arena, config, scenario);
+        std::vector<ObservationHead> heads(OBSERVE_HEADS);
+        Rng placement(3, 0);
+        for (auto& head : heads) {
+            float angle = placement.uniform(0.0f, 2.0f * static_cast<float>(M_PI));
+            head = ObservationHead{&map, Vec2(placement.uniform(0.0f, WIDTH), placement.uniform(0.0f, HEIGHT)), Vec2(std::cos(angle), std::sin(angle))};
+        }
+
+        double start = nowMs();
+        for (int i = 0; i < OBSERVE_ITERATIONS; ++i) map.build(arena);
+        double buildMs = (nowMs() - start) / OBSERVE_ITERATIONS;
+        std::vector<uint8_t> level1(static_cast<size_t>(map.width(1)) * map.height(1));
+        start = nowMs();
+        for (int i = 0; i < OBSERVE_ITERATIONS; ++i) boxFilter2x2(map.level(0), map.width(0), map.height(0), level1.data());
+        double filterUs = (nowMs() - start) * 1000 / OBSERVE_ITERATIONS;
+        start = nowMs();
+        for (int i = 0; i < OBSERVE_ITERATIONS; ++i) observeHeads(heads.data(), OBSERVE_HEADS, floats.data());
+        double floatUs = (nowMs() - start) * 1000 / OBSERVE_ITERATIONS / OBSERVE_HEADS;
+        start = nowMs();
+        for (int i = 0; i < OBSERVE_ITERATIONS; ++i) observeHeads(heads.data(), OBSERVE_HEADS, bytes.data());
+        double byteUs = (nowMs() - start) * 1000 / OBSERVE_ITERATIONS / OBSERVE_HEADS;
+
+        // Both outputs are the same samples, one scaled and one rounded
+        int differing = 0;
+        for (size_t i = 0; i < floats.size(); ++i) differing += std::fabs(floats[i] * 255.0f - bytes[i]) > 0.501f;
+        bool ok = differing == 0 && std::memcmp(level1.data(), map.level(1), level1.size()) == 0;
+        if (!ok) failures++;
+        std::printf("%-12s %10.3f %10.1f %12.2f %12.2f  %s\n", scenario.name, buildMs, filterUs, floatUs, byteUs, ok ? "ok" : "MISMATCH");
+    }
+    return failures ? 1 : 0;
+}
+
+struct PolicyNetwork {
+    const char* name;
+    int inputs;
+    int hidden[2];
+};
+
+// The feature observation through two hidden layers, wider ones, and the
+// occupancy grid
+const PolicyNetwork POLICY_NETWORKS[] = {
+    {"features-64", ENV_OBS_SIZE, {64, 64}},
+    {"features-256", ENV_OBS_SIZE, {256, 256}},
+    {"grid-64", OBS_GRID_CELLS, {64, 64}},
+};
+
+const int POLICY_BOTS = 512; // Evaluated per timed batch
+const int POLICY_ITERATIONS = 10;
+
+// A weight file for network: ReLU hidden layers, linear triggers out,
+// weights scaled to the layer's fan in
+void encodePolicy(const PolicyNetwork& network, uint32_t seed, std::vector<uint8_t>& out) {
+    auto put = [&out](const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        out.insert(out.end(), bytes, bytes + size);
+    };
+    auto putU32 = [&put](uint32_t value) { put(&value, sizeof(value)); };
+    out.clear();
+    Rng rng(seed, 0);
+    int widths[] = {network.inputs, network.hidden[0], network.hidden[1], 2};
+    putU32(POLICY_MAGIC);
+    putU32(POLICY_VERSION);
+    putU32(3);
+    putU32(static_cast<uint32_t>(network.inputs));
+    for (int layer = 0; layer < 3; ++layer) {
+        putU32(static_cast<uint32_t>(widths[layer + 1]));
+        putU32(layer < 2 ? POLICY_RELU : POLICY_LINEAR);
+        float scale = 1.0f / std::sqrt(static_cast<float>(widths[layer]));
+        for (int i = 0; i < (widths[layer] + 1) * widths[layer + 1]; ++i) {
+            float value = rng.uniform(-scale, scale);
+            put(&value, sizeof(value));
+        }
+    }
+}
+
+// The same network evaluated straight from the file bytes, in doubles
+void referencePolicy(const std::vector<uint8_t>& file, const float* input, double* output) {
+    uint32_t layerCount, inputs;
+    std::memcpy(&layerCount, &file[8], 4);
+    std::memcpy(&inputs, &file[12], 4);
+    std::vector<double> x(input, input + inputs), y;
+    size_t at = 16;
+    for (uint32_t layer = 0; layer < layerCount; ++layer) {
+        uint32_t outputs, activation;
+        std::memcpy(&outputs, &file[at], 4);
+        std::memcpy(&activation, &file[at + 4], 4);
+        at += 8;
+        const uint8_t* weights = &file[at];
+        const uint8_t* biases = weights + static_cast<size_t>(outputs) * x.size() * 4;
+        y.assign(outputs, 0.0);
+        for (uint32_t r = 0; r < outputs; ++r) {
+            float w, b;
+            for (size_t c = 0; c < x.size(); ++c) {
+                std::memcpy(&w, weights + (r * x.size() + c) * 4, 4);
+                y[r] += w * x[c];
+            }
+            std::memcpy(&b, biases + r * 4, 4);
+            y[r] += b;
+            if (activation == POLICY_RELU) y[r] = std::max(y[r], 0.0);
+            else if (activation == POLICY_TANH) y[r] = std::tanh(y[r]);
+        }
+        at += (static_cast<size_t>(outputs) * x.size() + outputs) * 4;
+        x.swap(y);
+    }
+    for (size_t i = 0; i < x.size(); ++i) output[i] = x[i];
+}
+
+int benchPolicy() {
+    GameConfig config;
+    int failures = 0;
+
+    // Real observations to feed the networks: a batch of matches a second in
+    JobSystem jobs(1);
+    VecEnv env(config, jobs);
+    env.reset(POLICY_BOTS / 2, 1);
+    std::vector<PlayerInput> actions(POLICY_BOTS, PlayerInput{8000, 0});
+    for (int step = 0; step < 60; ++step) env.step(actions.data());
+    std::vector<float> grids(static_cast<size_t>(POLICY_BOTS) * OBS_GRID_CELLS);
+    env.observeGrids(grids.data());
+
+    std::printf("%-13s %9s %10s %10s %12s  %s\n", "network", "params", "us/bot", "bots/ms", "max error", "check");
+    std::vector<uint8_t> file;
+    std::vector<float> outputs(POLICY_BOTS * 2);
+    for (const auto& network : POLICY_NETWORKS) {
+        encodePolicy(network, 5, file);
+        Policy policy;
+        bool ok = policy.parse(file.data(), file.size()) && PolicyBot::accepts(policy);
+        const float* inputs = network.inputs == ENV_OBS_SIZE ? env.observations() : grids.data();
+
+        // Broken files are refused: cut short, a byte too long, the wrong magic
+        Policy broken;
+        ok &= !broken.parse(file.data(), file.size() - 1) && broken.empty();
+        file.push_back(0);
+        ok &= !broken.parse(file.data(), file.size());
+        file.pop_back();
+        file[0] ^= 1;
+        ok &= !broken.parse(file.data(), file.size());
+        file[0] ^= 1;
+
+        double start = nowMs();
+        for (int i = 0; i < POLICY_ITERATIONS; ++i) policy.evaluate(inputs, POLICY_BOTS, outputs.data());
+        double us = (nowMs() - start) * 1000 / POLICY_ITERATIONS / POLICY_BOTS;
+
+        double maxError = 0;
+        for (int bot = 0; bot < POLICY_BOTS; bot += 37) {
+            double expected[2];
+            referencePolicy(file, inputs + static_cast<size_t>(bot) * network.inputs, expected);
+            for (int i = 0; i < 2; ++i) maxError = std::max(maxError, std::fabs(expected[i] - outputs[bot * 2 + i]) / (1.0 + std::fabs(expected[i])));
+        }
+        ok &= maxError < 1e-4;
+        if (!ok) failures++;
+        size_t params = (file.size() - 16 - 3 * 8) / 4;
+        std::printf("%-13s %9zu %10.2f %10.0f %12.2e  %s\n", network.name, params, us, 1000 / us, maxError, ok ? "ok" : "MISMATCH");
+    }
+    return failures ? 1 : 0;
+}
+
+const int DATASET_REPLAYS = 8;
+const int DATASET_FRAMES = 3600; // A minute each at 60Hz
+const char* const DATASET_BENCH_PATH = "bench.lnds";
+
+uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    return hash;
+}
+
+// Bot matches recorded as replays, standing in for a corpus of sessions. Odd
+// ones run with hits a tick late and are marked as occlusion recordings, as a
+// session played with --collision gl would be. Returns a hash of the rows the
+// export should make, (replay, frame, player, triggers, died) in order, and
+// counts them.
+uint64_t recordDatasetReplays(const GameConfig& config, std::vector<std::string>& paths, uint64_t& rows) {
+    uint64_t hash = 1469598103934665603ULL;
+    rows = 0;
+    for (uint32_t r = 0; r < DATASET_REPLAYS; ++r) {
+        CpuCollision cpu;
+        LateCollision late(cpu);
+        bool occlusion = r % 2 == 1;
+        CollisionBackend& collision = occlusion ? static_cast<CollisionBackend&>(late) : cpu;
+        paths.push_back("bench-" + std::to_string(r) + ".replay");
+        ReplayWriter writer;
+        if (!writer.open(paths.back(), r + 1, config, occlusion ? REPLAY_COLLISION_OCCLUSION : REPLAY_COLLISION_CPU)) return 0;
+        GameState state;
+        newGame(state, config, r + 1);
+        Bot bots[2] = {Bot(0), Bot(1)};
+        for (uint32_t frame = 0; frame < DATASET_FRAMES; ++frame) {
+            PlayerInput inputs[2] = {bots[0].think(state, config), bots[1].think(state, config)};
+            ReplayFrame record = {1.0f / 60, {{inputs[0].leftTrigger, inputs[0].rightTrigger}, {inputs[1].leftTrigger, inputs[1].rightTrigger}}};
+            bool living[2] = {false, false};
+            for (int p = 0; p < 2 && !state.gameOver; ++p) living[p] = state.players[p].alive;
+            writer.writeFrame(record);
+            stepGame(state, config, inputs, record.dt, collision);
+            for (uint8_t p = 0; p < 2; ++p) {
+                if (!living[p]) continue;
+                uint32_t key[2] = {r, frame};
+                uint8_t died = !state.players[p].alive;
+                hash = hashBytes(hashBytes(hashBytes(hash, key, sizeof(key)), &p, 1), record.triggers[p], sizeof(record.triggers[p]));
+                hash = hashBytes(hash, &died, 1);
+                rows++;
+            }
+        }
+    }
+    return hash;
+}
+
+// Exports the recorded bot matches at 1, 2, 4 ... maxThreads: rows a second
+// and MB written a second. Checks the file opens as a DatasetView, holds
+// exactly the recorded rows, triggers and died labels, and that every thread
+// count gives the same rows (chunks land in any order, so they are compared by
+// replay).
+int benchDataset(int maxThreads) {
+    GameConfig config;
+    std::vector<std::string> paths;
+    uint64_t expectedRows;
+    uint64_t expectedInputs = recordDatasetReplays(config, paths, expectedRows);
+    int failures = 0;
+    uint64_t expected = 0;
+    std::printf("%8s %8s %10s %8s %10s %12s %8s  %s\n", "threads", "replays", "rows", "MB", "ms", "rows/s", "MB/s", "hash");
+    for (int threads = 1;; threads = std::min(threads * 2, maxThreads)) {
+        DatasetStats stats;
+        double start = nowMs();
+        bool ok = exportDataset(paths, DATASET_BENCH_PATH, threads, stats);
+        double ms = nowMs() - start;
+
+        std::vector<uint64_t> file; // 8-byte aligned, as a mapping would be
+        {
+            std::ifstream in(DATASET_BENCH_PATH, std::ios::binary);
+            file.resize((stats.bytes + 7) / 8);
+            in.read(reinterpret_cast<char*>(file.data()), static_cast<std::streamsize>(stats.bytes));
+            ok = ok && in.gcount() == static_cast<std::streamsize>(stats.bytes);
+        }
+        DatasetView view;
+        ok = ok && view.open(reinterpret_cast<const uint8_t*>(file.data()), stats.bytes) && view.rows() == expectedRows;
+        uint64_t hash = 1469598103934665603ULL, inputs = 1469598103934665603ULL;
+        if (ok) {
+            std::vector<size_t> order(view.chunks());
+            for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+            std::sort(order.begin(), order.end(), [&view](size_t a, size_t b) {
+                return view.chunk(a).replay != view.chunk(b).replay ? view.chunk(a).replay < view.chunk(b).replay : view.chunk(a).firstRow < view.chunk(b).firstRow;
+            });
+            int replayColumn = view.column("replay"), frameColumn = view.column("frame"), playerColumn = view.column("player");
+            int leftColumn = view.column("left_trigger"), rightColumn = view.column("right_trigger"), diedColumn = view.column("died");
+            for (size_t k : order) {
+                uint32_t rows = view.chunk(k).rows;
+                for (int c = 0; c < view.columns(); ++c) hash = hashBytes(hash, view.array(k, c), rows * datasetTypeSize(view.columnInfo(c).type));
+                const uint32_t* replays = static_cast<const uint32_t*>(view.array(k, replayColumn));
+                const uint32_t* frames = static_cast<const uint32_t*>(view.array(k, frameColumn));
+                const uint8_t* players = static_cast<const uint8_t*>(view.array(k, playerColumn));
+                const int16_t* lefts = static_cast<const int16_t*>(view.array(k, leftColumn));
+                const int16_t* rights = static_cast<const int16_t*>(view.array(k, rightColumn));
+                const uint8_t* died = static_cast<const uint8_t*>(view.array(k, diedColumn));
+                for (uint32_t row = 0; row < rows; ++row) {
+                    uint32_t key[2] = {replays[row], frames[row]};
+                    int16_t triggers[2] = {lefts[row], rights[row]};
+                    inputs = hashBytes(hashBytes(hashBytes(inputs, key, sizeof(key)), &players[row], 1), triggers, sizeof(triggers));
+                    inputs = hashBytes(inputs, &died[row], 1);
+                }
+            }
+            ok = inputs == expectedInputs;
+        }
+        if (threads == 1) expected = hash;
+        ok = ok && hash == expected;
+        if (!ok) failures++;
+        std::printf("%8d %8d %10llu %8.1f %10.1f %12.0f %8.1f  %016llx%s\n", threads, stats.replays, static_cast<unsigned long long>(stats.rows),
+                    stats.bytes / 1048576.0, ms, stats.rows / (ms / 1000.0), stats.bytes / 1048576.0 / (ms / 1000.0),
+                    static_cast<unsigned long long>(hash), ok ? "" : "  MISMATCH");
+        if (threads >= maxThreads) break;
+    }
+    for (const auto& path : paths) std::remove(path.c_str());
+    std::remove(DATASET_BENCH_PATH);
+    return failures ? 1 : 0;
+}
+
+int benchRng() {
+    uint32_t sink = 0;
+    std::mt19937 mt(1);
+    Rng rng(1, RNG_CIRCLES);
+    GameState state;
+    size_t withMt = sizeof(GameState) - sizeof(state.rng) + sizeof(std::mt19937);
+    std::printf("%-10s %10s %14s %10s %12s\n", "generator", "bytes", "GameState", "copy_ns", "Mdraws/s");
+    std::printf("%-10s %10zu %14zu %10.1f %12.1f\n", "mt19937", sizeof(mt), withMt, copyNs(mt, sink), drawRate([&mt] { return mt(); }, sink));
+    std::printf("%-10s %10zu %14zu %10.1f %12.1f\n", "pcg32", sizeof(rng), sizeof(GameState), copyNs(rng, sink), drawRate([&rng] { return rng(); }, sink));
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    double mtFloats = drawRate([&mt, &unit] { return static_cast<uint32_t>(unit(mt) * 1000.0f); }, sink);
+    double rngFloats = drawRate([&rng] { return static_cast<uint32_t>(rng.uniform(0.0f, 1.0f) * 1000.0f); }, sink);
+    std::printf("uniform floats: mt19937 + uniform_real_distribution %.1f M/s, pcg32 uniform() %.1f M/s\n", mtFloats, rngFloats);
+
+    int failures = 0;
+    const uint64_t JUMPS[] = {0, 1, 2, 1000, 1234567};
+    for (uint64_t steps : JUMPS) {
+        Rng stepped(42, RNG_COLLECTIBLES), jumped(42, RNG_COLLECTIBLES);
+        for (uint64_t i = 0; i < steps; ++i) stepped();
+        jumped.advance(steps);
+        if (!(stepped == jumped) || stepped() != jumped()) {
+            std::printf("advance(%llu) MISMATCH\n", static_cast<unsigned long long>(steps));
+            failures++;
+        }
+    }
+    Rng far(42, RNG_COLLECTIBLES);
+    double start = nowMs();
+    for (int i = 0; i < 1000; ++i) far.advance(1ULL << 40);
+    std::printf("advance(2^40): %.0f ns\n", (nowMs() - start) * 1e6 / 1000);
+    sink += far();
+    rngSink = sink;
+    return failures ? 1 : 0;
+}
+
+#ifndef LINES_NO_THREADS
+const uint64_t QUEUE_ITEMS = 4000000; // Per run, split across producers
+const size_t QUEUE_CAPACITY = 1024;
+
+// Mutex + deque with the same interface, as the baseline the rings replace
+template <typename T>
+class LockedQueue {
+public:
+    explicit LockedQueue(size_t capacity) : capacity(capacity) {}
+    bool push(const T& value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (items.size() == capacity) return false;
+        items.push_back(value);
+        return true;
+    }
+    bool pop(T& value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (items.empty()) return false;
+        value = items.front();
+        items.pop_front();
+        return true;
+    }
+
+private:
+    size_t capacity;
+    std::mutex mutex;
+    std::deque<T> items;
+};
+
+// Producers push (producer << 48 | sequence); the consumer checks every
+// producer's items arrive once, in order, and that nothing is left over.
+// Returns items per microsecond, or a negative value on a violation.
+template <typename Queue>
+double stressQueue(int producers) {
+    Queue queue(QUEUE_CAPACITY);
+    uint64_t perProducer = QUEUE_ITEMS / producers;
+    std::vector<std::thread> threads;
+    double start = nowMs();
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&queue, p, perProducer] {
+            for (uint64_t i = 0; i < perProducer; ++i) {
+                while (!queue.push(static_cast<uint64_t>(p) << 48 | i)) std::this_thread::yield();
+            }
+        });
+    }
+    std::vector<uint64_t> expected(producers, 0);
+    bool ok = true;
+    for (uint64_t received = 0; received < perProducer * producers;) {
+        uint64_t value;
+        if (!queue.pop(value)) {
+            std::this_thread::yield();
+            continue;
+        }
+        size_t p = static_cast<size_t>(value >> 48);
+        if (p >= expected.size() || (value & 0xffffffffffffULL) != expected[p]) ok = false;
+        else expected[p]++;
+        received++;
+    }
+    double ms = nowMs() - start;
+    for (auto& thread : threads) thread.join();
+    uint64_t extra;
+    if (queue.pop(extra)) ok = false;
+    return ok ? perProducer * producers / (ms * 1000.0) : -1;
+}
+
+int benchQueues(int maxThreads) {
+    int failures = 0;
+    std::printf("%-6s %9s %12s %12s\n", "queue", "producers", "Mitems/s", "locked");
+    auto report = [&failures](const char* name, int producers, double rate, double locked) {
+        std::printf("%-6s %9d %12.2f %12.2f%s\n", name, producers, rate, locked, rate < 0 ? "  ORDER VIOLATION" : "");
+        if (rate < 0) failures++;
+    };
+    report("spsc", 1, stressQueue<SpscQueue<uint64_t>>(1), stressQueue<LockedQueue<uint64_t>>(1));
+    int most = std::max(2, maxThreads - 1); // Producers beside the consumer, at least two to contend
+    for (int producers = 1;; producers = std::min(producers * 2, most)) {
+        report("mpsc", producers, stressQueue<MpscQueue<uint64_t>>(producers), stressQueue<LockedQueue<uint64_t>>(producers));
+        if (producers >= most) break;
+    }
+    return failures ? 1 : 0;
+}
+#endif
+
+} // namespace
+
+int runBench(const std::string& name, int maxThreads) {
+    if (name == "erase") return benchErase(maxThreads);
+    if (name == "runahead") return benchRunAhead(maxThreads);
+    if (name == "rng") return benchRng();
+    if (name == "rewind") return benchRewind(maxThreads);
+    if (name == "checkpoint") return benchCheckpoint();
+    if (name == "snapshot") return benchSnapshot();
+    if (name == "env") return benchEnv(maxThreads);
+    if (name == "observe") return benchObserve();
+    if (name == "policy") return benchPolicy();
+    if (name == "dataset") return benchDataset(maxThreads);
+    if (name == "queues") {
+#ifndef LINES_NO_THREADS
+        return benchQueues(maxThreads);
+#else
+        std::fprintf(stderr, "The queues benchmark needs threads\n");
+        return 1;
+#endif
+    }
+    std::fprintf(stderr, "Unknown benchmark: %s (erase, runahead, rng, rewind, checkpoint, snapshot, env, observe, policy, dataset, queues)\n", name.c_str());
+    return 1;
+}
@@ -0,0 +1,51 @@
+#include "bot.h"
+#include <cmath>
+
+namespace {
+
+const float PROBE_STEP = 8.0f; // Pixels between probe samples
+const float PROBE_RANGE = 320.0f; // How far ahead a heading is checked
+const float PROBE_TURN_TIME = 0.25f; // Seconds of full turn for the outermost candidates
+const float TURNS[] = {-1.0f, -0.5f, 0.0f, 0.5f, 1.0f}; // Candidate trigger deflections
+const float COLLECTIBLE_WEIGHT = 80.0f; // Pixels of free space a perfect heading to the collectible is worth
+
+} // namespace
+
+Bot::Bot(int player, uint64_t thinkIntervalUs)
+    : player(player), interval(thinkIntervalUs), nextThinkUs(0), held{0, 0} {}
+
+float Bot::freeDistance(const GameState& state, const Vec2& from, float angle) {
+    Vec2 dir(cos(angle), sin(angle));
+    for (float d = PROBE_STEP; d <= PROBE_RANGE; d += PROBE_STEP) {
+        Vec2 p = from + dir * d;
+        if (p.x < 0 || p.x > WIDTH || p.y < 0 || p.y > HEIGHT) return d;
+        if (probe.hit(state, player, p)) return d;
+    }
+    return PROBE_RANGE;
+}
+
+PlayerInput Bot::think(const GameState& state, const GameConfig& config) {
+    const Player& self = state.players[player];
+    if (state.gameOver || !self.alive) return PlayerInput{0, 0};
+    if (state.simTimeUs < nextThinkUs) return held;
+    nextThinkUs = state.simTimeUs + interval;
+
+    float heading = atan2(self.direction.y, self.direction.x);
+    Vec2 toCollectible(state.collectible.pos.x - self.pos.x, state.collectible.pos.y - self.pos.y);
+    float collectibleAngle = atan2(toCollectible.y, toCollectible.x);
+
+    float bestScore = -1e9f, bestTurn = 0;
+    for (float turn : TURNS) {
+        float angle = heading + turn * config.turnSpeed * PROBE_TURN_TIME;
+        float score = freeDistance(state, self.pos, angle);
+        if (score >= PROBE_RANGE) score += COLLECTIBLE_WEIGHT * cos(angle - collectibleAngle);
+        if (score > bestScore) {
+            bestScore = score;
+            bestTurn = turn;
+        }
+    }
+    int16_t amount = static_cast<int16_t>(std::fabs(bestTurn) * 32767);
+    held = bestTurn < 0 ? PlayerInput{amount, 0} : PlayerInput{0, amount};
+    if (!self.hasMoved && amount == 0) held = PlayerInput{1, 1}; // Straight on, but pressed: ends spawn immunity as a player's first press does
+    return held;
+}
@@ -0,0 +1,63 @@
+#include "capture.h"
+#include "game.h"
+#include "jobs.h"
+#include "render.h"
+#include "replay.h"
+#include "softraster.h"
+#include <cstdio>
+
+int runScreenshot(const std::string& replayPath, const std::string& outPath, int every, int threads) {
+    ReplayReader replay;
+    if (!replay.open(replayPath)) {
+        std::fprintf(stderr, "Cannot read replay %s\n", replayPath.c_str());
+        return 1;
+    }
+    CpuCollision cpuCollision;
+    LateCollision lateCollision(cpuCollision);
+    CollisionBackend* collision = playbackCollision(replay, cpuCollision, lateCollision); // Hits on the ticks they were recorded on
+    if (!collision) {
+        std::fprintf(stderr, "Replay %s does not record its collision backend (older than version 4)\n", replayPath.c_str());
+        return 1;
+    }
+    GameConfig config = replay.headerConfig();
+    GameState state;
+    replay.startMatch(state);
+    JobSystem jobs(threads);
+    RenderList list;
+    SoftRenderer renderer;
+    std::string stem = outPath.size() > 4 && outPath.compare(outPath.size() - 4, 4, ".ppm") == 0 ? outPath.substr(0, outPath.size() - 4) : outPath;
+
+    ReplayFrame frame;
+    GameConfig next = config;
+    ReplayRecord record;
+    int frames = 0;
+    while ((record = replay.next(frame, next)) == REPLAY_FRAME || record == REPLAY_CONFIG) {
+        if (record == REPLAY_CONFIG) {
+            applyConfig(state, config, next);
+            continue;
+        }
+        PlayerInput inputs[2] = {{frame.triggers[0][0], frame.triggers[0][1]}, {frame.triggers[1][0], frame.triggers[1][1]}};
+        stepGame(state, config, inputs, frame.dt, *collision, &jobs);
+        ++frames; // Also names the last good frame if the file turns out damaged
+        if (every > 0 && frames % every == 0) {
+            char suffix[32];
+            std::snprintf(suffix, sizeof(suffix), "-%06d.ppm", frames);
+            list.clear();
+            drawScene(list, state);
+            renderer.render(list, &jobs);
+            if (!renderer.writePpm(stem + suffix)) std::fprintf(stderr, "Cannot write %s%s\n", stem.c_str(), suffix);
+        }
+    }
+    if (record == REPLAY_ERROR) {
+        std::fprintf(stderr, "Replay %s is damaged after frame %d\n", replayPath.c_str(), frames);
+        return 1;
+    }
+    list.clear();
+    drawScene(list, state);
+    renderer.render(list, &jobs);
+    if (!renderer.writePpm(outPath)) {
+        std::fprintf(stderr, "Cannot write %s\n", outPath.c_str());
+        return 1;
+    }
+    return 0;
+}
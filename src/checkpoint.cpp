@@ -0,0 +1,345 @@
+#include "checkpoint.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#if defined(_WIN32)
+#include <io.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+namespace {
+
+const size_t HEADER_SIZE = 20; // Magic, version, payload size, hash
+const float POSITION_SCALE = 256.0f; // Trail positions in 1/256 pixel
+const int WRITER_IDLE_MS = 5; // Checkpoints are a second apart
+
+uint64_t hashBytes(const uint8_t* data, size_t size) {
+    uint64_t hash = 1469598103934665603ULL; // FNV-1a
+    for (size_t i = 0; i < size; ++i) hash = (hash ^ data[i]) * 1099511628211ULL;
+    return hash;
+}
+
+struct Encoder {
+    std::vector<uint8_t>& out;
+
+    void raw(const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        out.insert(out.end(), bytes, bytes + size);
+    }
+
+    template <typename T>
+    void value(const T& item) { raw(&item, sizeof(item)); }
+
+    void varint(uint64_t number) {
+        while (number >= 0x80) {
+            out.push_back(static_cast<uint8_t>(number | 0x80));
+            number >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(number));
+    }
+
+    void signedVarint(int64_t number) { varint(static_cast<uint64_t>(number) << 1 ^ static_cast<uint64_t>(number >> 63)); } // Zigzag
+};
+
+// Every read checks the bounds; ok goes false on the first one past the end
+struct Decoder {
+    const uint8_t* data;
+    size_t size, at;
+    bool ok;
+
+    void raw(void* into, size_t count) {
+        if (!ok || size - at < count) {
+            ok = false;
+            return;
+        }
+        std::memcpy(into, data + at, count);
+        at += count;
+    }
+
+    template <typename T>
+    void value(T& item) { raw(&item, sizeof(item)); }
+
+    uint64_t varint() {
+        uint64_t number = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (!ok || at == size) break;
+            uint8_t byte = data[at++];
+            number |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return number;
+        }
+        ok = false;
+        return 0;
+    }
+
+    int64_t signedVarint() {
+        uint64_t number = varint();
+        return static_cast<int64_t>(number >> 1) ^ -static_cast<int64_t>(number & 1);
+    }
+
+    size_t count() { // Of items at least a byte each, so a bad one cannot ask for more than is left
+        uint64_t number = varint();
+        if (number > size - at) ok = false;
+        return ok ? static_cast<size_t>(number) : 0;
+    }
+};
+
+int32_t quantize(float position) {
+    return static_cast<int32_t>(std::lround(position * POSITION_SCALE));
+}
+
+// Points in the order they were laid, each as the gap in seq (0 unless
+// something was erased) and the step from the point before
+void encodeTrail(Encoder& out, const Trail& trail, std::vector<TrailPoint>& points) {
+    points.clear();
+    for (int t = 0; t < TRAIL_TILE_COUNT; ++t) points.insert(points.end(), trail.tile(t).begin(), trail.tile(t).end());
+    std::sort(points.begin(), points.end(), [](const TrailPoint& a, const TrailPoint& b) { return a.seq < b.seq; });
+    out.varint(points.size());
+    uint32_t seq = 0;
+    int32_t x = 0, y = 0;
+    for (const auto& point : points) {
+        int32_t px = quantize(point.pos.x), py = quantize(point.pos.y);
+        out.varint(point.seq - seq);
+        out.signedVarint(px - x);
+        out.signedVarint(py - y);
+        seq = point.seq + 1;
+        x = px;
+        y = py;
+    }
+}
+
+void decodeTrail(Decoder& in, Trail& trail) {
+    trail.clear();
+    size_t count = in.count();
+    uint32_t seq = 0;
+    int32_t x = 0, y = 0;
+    for (size_t i = 0; i < count && in.ok; ++i) {
+        seq += static_cast<uint32_t>(in.varint());
+        x += static_cast<int32_t>(in.signedVarint());
+        y += static_cast<int32_t>(in.signedVarint());
+        trail.place(TrailPoint{Vec2(x / POSITION_SCALE, y / POSITION_SCALE), seq});
+        seq++;
+    }
+}
+
+bool readFile(const std::string& path, std::vector<uint8_t>& data) {
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+    data.clear();
+    uint8_t chunk[65536];
+    size_t got;
+    while ((got = std::fread(chunk, 1, sizeof(chunk), file)) > 0) data.insert(data.end(), chunk, chunk + got);
+    std::fclose(file);
+    return true;
+}
+
+// Flushes the file through to the disk, not just the OS, so the rename
+// cannot land before the data does
+void syncFile(FILE* file) {
+    std::fflush(file);
+#if defined(_WIN32)
+    _commit(_fileno(file));
+#elif defined(__unix__) || defined(__APPLE__)
+    fsync(fileno(file));
+#endif
+}
+
+bool replaceFile(const std::string& from, const std::string& to) {
+#ifdef _WIN32
+    std::remove(to.c_str()); // rename() will not replace there; loadCheckpoint falls back to the .tmp meanwhile
+#endif
+    return std::rename(from.c_str(), to.c_str()) == 0;
+}
+
+} // namespace
+
+void encodeCheckpoint(const GameState& state, std::vector<uint8_t>& out) {
+    std::vector<TrailPoint> points; // Sort scratch, shared by both trails
+    Scheduler::Saved saved;
+    out.assign(HEADER_SIZE, 0);
+    Encoder payload{out};
+    payload.value(state.simTimeUs);
+    payload.value(state.roundStartUs);
+    payload.value(state.scores);
+    payload.value(static_cast<uint8_t>(state.gameOver));
+    payload.value(state.countdown);
+    payload.value(state.spawnTimer);
+    payload.value(state.countdownTimer);
+    payload.value(state.rng);
+    state.scheduler.save(saved);
+    payload.value(saved.nowUs);
+    payload.value(saved.cursorTick);
+    payload.value(saved.nextId);
+    payload.varint(saved.timers.size());
+    for (const auto& timer : saved.timers) { // By field: Timer has padding
+        payload.value(timer.id);
+        payload.value(timer.type);
+        payload.value(timer.arg);
+        payload.value(timer.due);
+        payload.value(timer.interval);
+    }
+    payload.value(state.collectible);
+    payload.varint(state.circles.size());
+    for (const auto& circle : state.circles) payload.value(circle);
+    for (const auto& player : state.players) {
+        payload.value(player.pos);
+        payload.value(player.direction);
+        payload.value(player.color);
+        uint8_t flags = player.alive | player.willDie << 1 | player.hasMoved << 2;
+        payload.value(flags);
+        payload.value(player.killedBy);
+        Trail::Cursor cursor = player.trail.cursor();
+        payload.value(cursor.nextSeq);
+        payload.value(cursor.newestPos);
+        payload.value(cursor.newestDirection);
+        encodeTrail(payload, player.trail, points);
+    }
+
+    uint32_t size = static_cast<uint32_t>(out.size() - HEADER_SIZE);
+    uint64_t hash = hashBytes(out.data() + HEADER_SIZE, size);
+    std::memcpy(&out[0], &CHECKPOINT_MAGIC, 4);
+    std::memcpy(&out[4], &CHECKPOINT_VERSION, 4);
+    std::memcpy(&out[8], &size, 4);
+    std::memcpy(&out[12], &hash, 8);
+}
+
+bool decodeCheckpoint(const uint8_t* data, size_t size, GameState& state) {
+    uint32_t magic, version, payloadSize;
+    uint64_t hash;
+    if (size < HEADER_SIZE) return false;
+    std::memcpy(&magic, data, 4);
+    std::memcpy(&version, data + 4, 4);
+    std::memcpy(&payloadSize, data + 8, 4);
+    std::memcpy(&hash, data + 12, 8);
+    if (magic != CHECKPOINT_MAGIC || version != CHECKPOINT_VERSION || payloadSize != size - HEADER_SIZE ||
+        hash != hashBytes(data + HEADER_SIZE, payloadSize)) return false;
+
+    // From here the bytes are as written; a failure now is a bad writer, and leaves state half loaded
+    Decoder in{data + HEADER_SIZE, payloadSize, 0, true};
+    uint8_t gameOver = 0;
+    in.value(state.simTimeUs);
+    in.value(state.roundStartUs);
+    in.value(state.scores);
+    in.value(gameOver);
+    state.gameOver = gameOver != 0;
+    in.value(state.countdown);
+    in.value(state.spawnTimer);
+    in.value(state.countdownTimer);
+    in.value(state.rng);
+    Scheduler::Saved saved;
+    in.value(saved.nowUs);
+    in.value(saved.cursorTick);
+    in.value(saved.nextId);
+    saved.timers.resize(in.count());
+    for (auto& timer : saved.timers) {
+        in.value(timer.id);
+        in.value(timer.type);
+        in.value(timer.arg);
+        in.value(timer.due);
+        in.value(timer.interval);
+    }
+    if (!in.ok) return false;
+    state.scheduler.load(saved);
+    in.value(state.collectible);
+    state.circles.resize(in.count());
+    for (auto& circle : state.circles) in.value(circle);
+    for (auto& player : state.players) {
+        uint8_t flags = 0;
+        Trail::Cursor cursor;
+        in.value(player.pos);
+        in.value(player.direction);
+        in.value(player.color);
+        in.value(flags);
+        player.alive = flags & 1;
+        player.willDie = flags & 2;
+        player.hasMoved = flags & 4;
+        in.value(player.killedBy);
+        in.value(cursor.nextSeq);
+        in.value(cursor.newestPos);
+        in.value(cursor.newestDirection);
+        decodeTrail(in, player.trail);
+        player.trail.setCursor(cursor);
+    }
+    return in.ok && in.at == in.size;
+}
+
+bool loadCheckpoint(const std::string& path, GameState& state) {
+    // A .tmp that checks out is newer: the writer died between syncing it and the rename
+    std::vector<uint8_t> data;
+    for (const std::string& candidate : {path + ".tmp", path}) {
+        if (readFile(candidate, data) && decodeCheckpoint(data.data(), data.size(), state)) return true;
+    }
+    return false;
+}
+
+CheckpointWriter::CheckpointWriter(const std::string& path)
+    : path(path), ready(SLOT_COUNT), spare(SLOT_COUNT), stopping(false), closed(false), closedSeen(false), writtenCount(0), lastSize(0) {
+    for (auto& slot : slots) spare.push(&slot);
+#ifndef LINES_NO_THREADS
+    thread = std::thread(&CheckpointWriter::writerLoop, this);
+#endif
+}
+
+CheckpointWriter::~CheckpointWriter() {
+    stopping = true;
+#ifndef LINES_NO_THREADS
+    if (thread.joinable()) thread.join();
+#endif
+}
+
+bool CheckpointWriter::submit(const GameState& state) {
+    if (closed.load(std::memory_order_acquire)) return true; // Nothing more to write; not worth a retry
+#ifdef LINES_NO_THREADS
+    write(state);
+    return true;
+#else
+    GameState* slot;
+    if (!spare.pop(slot)) return false;
+    *slot = state; // Copy assignment reuses the slot's buffers
+    ready.push(slot);
+    return true;
+#endif
+}
+
+void CheckpointWriter::discard() {
+    closed.store(true, std::memory_order_release);
+#ifndef LINES_NO_THREADS
+    while (thread.joinable() && !closedSeen.load(std::memory_order_acquire)) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+    std::remove(path.c_str());
+    std::remove((path + ".tmp").c_str());
+}
+
+void CheckpointWriter::write(const GameState& state) {
+    encodeCheckpoint(state, buffer);
+    std::string temp = path + ".tmp";
+    FILE* file = std::fopen(temp.c_str(), "wb");
+    if (!file) return;
+    bool ok = std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    syncFile(file);
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok || !replaceFile(temp, path)) return; // The previous checkpoint stands
+    lastSize.store(buffer.size(), std::memory_order_relaxed);
+    writtenCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CheckpointWriter::writerLoop() {
+#ifndef LINES_NO_THREADS
+    for (;;) {
+        // Checked between writes, so once discard() hears back nothing renames over its delete
+        bool shut = closed.load(std::memory_order_acquire);
+        if (shut) closedSeen.store(true, std::memory_order_release);
+        GameState* slot;
+        if (ready.pop(slot)) {
+            if (!shut) write(*slot);
+            spare.push(slot);
+        } else if (stopping.load(std::memory_order_acquire)) {
+            break;
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(WRITER_IDLE_MS));
+        }
+    }
+#endif
+}
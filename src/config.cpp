@@ -0,0 +1,182 @@
+#include "config.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#define LINES_INOTIFY
+#endif
+
+namespace {
+
+struct ConfigField {
+    const char* name;
+    float GameConfig::* floatValue;
+    int GameConfig::* intValue;
+    double min, max; // Inclusive; outside it the game stalls or the arena math breaks
+};
+
+const ConfigField FIELDS[] = {
+    {"PLAYER_SPEED", &GameConfig::playerSpeed, nullptr, 10, 2000},
+    {"CIRCLE_SPEED", &GameConfig::circleSpeed, nullptr, 10, 3000},
+    {"TURN_SPEED", &GameConfig::turnSpeed, nullptr, 0.1, 30},
+    {"CIRCLE_RADIUS", &GameConfig::circleRadius, nullptr, 1, 400}, // Circles spawn 50px in, so they stay mostly inside
+    {"COLLECTIBLE_SIZE", &GameConfig::collectibleSize, nullptr, 1, 200}, // The 5x cleared square has to fit in HEIGHT
+    {"CIRCLE_SPAWN_INTERVAL", &GameConfig::circleSpawnInterval, nullptr, 0.1, 3600}, // Tiny intervals flood the scheduler
+    {"GAME_OVER_COUNTDOWN", nullptr, &GameConfig::gameOverCountdown, 1, 60},
+};
+
+const ConfigField* findField(const std::string& key) {
+    for (const auto& f : FIELDS) {
+        if (key == f.name) return &f;
+    }
+    return nullptr;
+}
+
+std::string trim(const std::string& s) {
+    size_t start = s.find_first_not_of(" \t\r");
+    if (start == std::string::npos) return "";
+    size_t end = s.find_last_not_of(" \t\r");
+    return s.substr(start, end - start + 1);
+}
+
+long long modifiedTime(const std::string& path) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) return -1;
+    return static_cast<long long>(info.st_mtime);
+}
+
+} // namespace
+
+bool configRange(const std::string& key, double& min, double& max) {
+    const ConfigField* f = findField(key);
+    if (!f) return false;
+    min = f->min;
+    max = f->max;
+    return true;
+}
+
+bool configInteger(const std::string& key) {
+    const ConfigField* f = findField(key);
+    return f && f->intValue;
+}
+
+bool setConfigValue(GameConfig& config, const std::string& key, double value) {
+    const ConfigField* f = findField(key);
+    if (!f || !(value >= f->min && value <= f->max)) return false; // NaN fails too
+    if (f->intValue && value != std::floor(value)) return false; // Rather than truncate 2.9 to 2
+    if (f->floatValue) config.*f->floatValue = static_cast<float>(value);
+    else config.*f->intValue = static_cast<int>(value);
+    return true;
+}
+
+bool parseConfig(const std::string& text, GameConfig& config) {
+    GameConfig parsed = config;
+    std::istringstream in(text);
+    std::string line;
+    int lineNumber = 0;
+    bool ok = true;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) continue;
+        size_t eq = line.find('=');
+        std::string key = trim(line.substr(0, eq));
+        std::string value = eq == std::string::npos ? "" : trim(line.substr(eq + 1));
+        char* end = nullptr;
+        double number = value.empty() ? 0 : std::strtod(value.c_str(), &end);
+        double min, max;
+        if (value.empty() || *end != '\0' || !setConfigValue(parsed, key, number)) {
+            bool numeric = !value.empty() && *end == '\0';
+            if (numeric && configRange(key, min, max) && !(number >= min && number <= max)) {
+                std::fprintf(stderr, "config: line %d: ignoring '%s', %s is %g to %g\n", lineNumber, line.c_str(), key.c_str(), min, max);
+            } else if (numeric && configInteger(key)) {
+                std::fprintf(stderr, "config: line %d: ignoring '%s', %s takes whole numbers\n", lineNumber, line.c_str(), key.c_str());
+            } else {
+                std::fprintf(stderr, "config: line %d: ignoring '%s'\n", lineNumber, line.c_str());
+            }
+            ok = false;
+        }
+    }
+    config = parsed;
+    return ok;
+}
+
+bool loadConfig(const std::string& path, GameConfig& config) {
+    std::ifstream file(path);
+    if (!file) return false;
+    std::stringstream text;
+    text << file.rdbuf();
+    parseConfig(text.str(), config);
+    return true;
+}
+
+std::string formatConfig(const GameConfig& config) {
+    std::string text;
+    char line[96];
+    for (const auto& f : FIELDS) {
+        if (f.floatValue) std::snprintf(line, sizeof(line), "%s = %.9g\n", f.name, config.*f.floatValue);
+        else std::snprintf(line, sizeof(line), "%s = %d\n", f.name, config.*f.intValue);
+        text += line;
+    }
+    return text;
+}
+
+ConfigWatcher::ConfigWatcher(const std::string& path)
+    : path(path), inotifyFd(-1), lastModified(modifiedTime(path)), pollCounter(0) {
+    size_t slash = path.find_last_of("/\\");
+    fileName = slash == std::string::npos ? path : path.substr(slash + 1);
+#ifdef LINES_INOTIFY
+    // Watch the directory: editors often save by renaming a new file over the old one
+    std::string dir = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd >= 0 && inotify_add_watch(inotifyFd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+        close(inotifyFd);
+        inotifyFd = -1;
+    }
+#endif
+}
+
+ConfigWatcher::~ConfigWatcher() {
+#ifdef LINES_INOTIFY
+    if (inotifyFd >= 0) close(inotifyFd);
+#endif
+}
+
+bool ConfigWatcher::changed() {
+#ifdef LINES_INOTIFY
+    if (inotifyFd >= 0) {
+        alignas(inotify_event) char buffer[4096];
+        bool hit = false;
+        ssize_t len;
+        while ((len = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+            for (char* p = buffer; p < buffer + len;) {
+                auto* event = reinterpret_cast<inotify_event*>(p);
+                if (event->len && fileName == event->name) hit = true;
+                p += sizeof(inotify_event) + event->len;
+            }
+        }
+        return hit;
+    }
+#endif
+    // No inotify: stat the file about once a second at 60fps
+    if (++pollCounter < 60) return false;
+    pollCounter = 0;
+    long long modified = modifiedTime(path);
+    if (modified == lastModified) return false;
+    lastModified = modified;
+    return true;
+}
+
+bool ConfigWatcher::poll(GameConfig& config) {
+    if (!changed()) return false;
+    GameConfig reloaded = config;
+    if (!loadConfig(path, reloaded)) return false;
+    if (formatConfig(reloaded) == formatConfig(config)) return false;
+    config = reloaded;
+    return true;
+}
@@ -0,0 +1,350 @@
+#include "dataset.h"
+#include "env.h"
+#include "game.h"
+#include "replay.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#ifndef LINES_NO_THREADS
+#include <mutex>
+#include <thread>
+#endif
+
+namespace {
+
+struct ColumnSpec {
+    const char* name;
+    DatasetType type;
+};
+
+// In Column order
+const ColumnSpec COLUMNS[] = {
+    {"replay", DATASET_U32}, {"frame", DATASET_U32}, {"player", DATASET_U8}, {"dt", DATASET_F32}, {"sim_time_us", DATASET_U64},
+    {"pos_x", DATASET_F32}, {"pos_y", DATASET_F32}, {"dir_x", DATASET_F32}, {"dir_y", DATASET_F32},
+    {"score", DATASET_U32}, {"opponent_score", DATASET_U32},
+    {"alive", DATASET_F32}, {"collectible_ahead", DATASET_F32}, {"collectible_right", DATASET_F32},
+    {"opponent_ahead", DATASET_F32}, {"opponent_right", DATASET_F32}, {"opponent_heading_cos", DATASET_F32}, {"opponent_heading_sin", DATASET_F32},
+    {"circle_ahead", DATASET_F32}, {"circle_right", DATASET_F32}, {"circle_speed_ahead", DATASET_F32}, {"circle_speed_right", DATASET_F32},
+    {"ray_0", DATASET_F32}, {"ray_1", DATASET_F32}, {"ray_2", DATASET_F32}, {"ray_3", DATASET_F32},
+    {"ray_4", DATASET_F32}, {"ray_5", DATASET_F32}, {"ray_6", DATASET_F32}, {"ray_7", DATASET_F32},
+    {"left_trigger", DATASET_I16}, {"right_trigger", DATASET_I16}, {"died", DATASET_U8},
+};
+const int COLUMN_COUNT = sizeof(COLUMNS) / sizeof(COLUMNS[0]);
+
+enum Column {
+    COL_REPLAY, COL_FRAME, COL_PLAYER, COL_DT, COL_SIM_TIME,
+    COL_POS_X, COL_POS_Y, COL_DIR_X, COL_DIR_Y, COL_SCORE, COL_OPPONENT_SCORE,
+    COL_OBSERVATION, // ENV_OBS_SIZE of them
+    COL_LEFT_TRIGGER = COL_OBSERVATION + ENV_OBS_SIZE, COL_RIGHT_TRIGGER, COL_DIED
+};
+static_assert(COL_DIED + 1 == COLUMN_COUNT, "a name and type for every column");
+static_assert(sizeof(DatasetHeader) == 48 && sizeof(DatasetColumn) == 32 && sizeof(DatasetChunk) == 16, "directory entries are stored as they are in memory");
+
+const uint32_t MAX_COLUMNS = 4096; // Far more than exported; bounds what open() trusts
+
+size_t aligned(size_t size) {
+    return (size + DATASET_ALIGN - 1) & ~(DATASET_ALIGN - 1);
+}
+
+// One worker's rows, until they fill a chunk or the replay ends
+struct ChunkBuffer {
+    std::vector<uint8_t> columns[COLUMN_COUNT]; // Sized for a full chunk once
+    uint32_t rows = 0;
+    uint32_t replay = 0;
+
+    ChunkBuffer() {
+        for (int i = 0; i < COLUMN_COUNT; ++i) columns[i].resize(DATASET_CHUNK_ROWS * datasetTypeSize(COLUMNS[i].type));
+    }
+
+    template <typename T>
+    void set(int column, uint32_t row, T value) {
+        std::memcpy(&columns[column][row * sizeof(T)], &value, sizeof(T));
+    }
+};
+
+// Appends chunks from any worker; the directory and header go on at finish()
+class ChunkWriter {
+public:
+    ~ChunkWriter() {
+        if (file) std::fclose(file);
+    }
+
+    bool open(const std::string& path) {
+        file = std::fopen(path.c_str(), "wb");
+        if (!file) return false;
+        DatasetHeader blank = {}; // No magic until the directory is down
+        put(&blank, sizeof(blank));
+        return !failed;
+    }
+
+    void write(const ChunkBuffer& chunk) {
+#ifndef LINES_NO_THREADS
+        std::lock_guard<std::mutex> guard(mutex);
+#endif
+        chunks.push_back(DatasetChunk{rowCount, chunk.rows, chunk.replay});
+        rowCount += chunk.rows;
+        for (int i = 0; i < COLUMN_COUNT; ++i) {
+            pad();
+            offsets.push_back(at);
+            put(chunk.columns[i].data(), chunk.rows * datasetTypeSize(COLUMNS[i].type));
+        }
+    }
+
+    bool finish(DatasetStats& stats) {
+        pad();
+        DatasetHeader header = {};
+        header.magic = DATASET_MAGIC;
+        header.version = DATASET_VERSION;
+        header.columnCount = COLUMN_COUNT;
+        header.chunkRows = DATASET_CHUNK_ROWS;
+        header.rowCount = rowCount;
+        header.chunkCount = chunks.size();
+        header.directoryOffset = at;
+        for (const auto& spec : COLUMNS) {
+            DatasetColumn column = {};
+            std::strncpy(column.name, spec.name, sizeof(column.name) - 1);
+            column.type = spec.type;
+            put(&column, sizeof(column));
+        }
+        if (!chunks.empty()) put(chunks.data(), chunks.size() * sizeof(DatasetChunk));
+        if (!offsets.empty()) put(offsets.data(), offsets.size() * sizeof(uint64_t));
+        header.size = at;
+        if (std::fseek(file, 0, SEEK_SET) != 0) failed = true;
+        put(&header, sizeof(header));
+        if (std::fclose(file) != 0) failed = true;
+        file = nullptr;
+        stats.rows = rowCount;
+        stats.bytes = header.size;
+        return !failed;
+    }
+
+private:
+    void put(const void* data, size_t size) {
+        if (size && std::fwrite(data, 1, size, file) != size) failed = true;
+        at += size;
+    }
+
+    void pad() {
+        static const uint8_t zeros[DATASET_ALIGN] = {};
+        put(zeros, aligned(at) - at);
+    }
+
+    FILE* file = nullptr;
+    uint64_t at = 0;
+    uint64_t rowCount = 0;
+    bool failed = false;
+    std::vector<DatasetChunk> chunks;
+    std::vector<uint64_t> offsets; // Per chunk, per column
+#ifndef LINES_NO_THREADS
+    std::mutex mutex;
+#endif
+};
+
+// Plays the replay as capture does, a frame at a time, writing a row for each
+// living player before the frame is stepped and whether it died after. Hits
+// land on the ticks they did when it was recorded (playbackCollision), or the
+// died labels would not match the session; error says why a replay was refused.
+bool exportReplay(const std::string& path, uint32_t index, ChunkBuffer& buffer, ChunkWriter& writer, std::string& error) {
+    ReplayReader replay;
+    ReplayFrame frame;
+    ReplayRecord record;
+    GameConfig next;
+    if (!replay.open(path)) {
+        error = "cannot read replay";
+        return false;
+    }
+    // Read through once first: a damaged replay is refused before any of its rows reach a chunk
+    while ((record = replay.next(frame, next)) == REPLAY_FRAME || record == REPLAY_CONFIG) {}
+    if (record == REPLAY_ERROR || !replay.open(path)) {
+        error = "replay is truncated or damaged";
+        return false;
+    }
+    CpuCollision probe; // Observation rays, always this tick's arena
+    LateCollision late(probe);
+    CollisionBackend* collision = playbackCollision(replay, probe, late);
+    if (!collision) {
+        error = "replay does not record its collision backend (older than version 4)";
+        return false;
+    }
+    GameConfig config = replay.headerConfig();
+    next = config;
+    GameState state;
+    replay.startMatch(state);
+    buffer.rows = 0;
+    buffer.replay = index;
+
+    uint32_t frameIndex = 0;
+    float observation[ENV_OBS_SIZE];
+    while ((record = replay.next(frame, next)) == REPLAY_FRAME || record == REPLAY_CONFIG) {
+        if (record == REPLAY_CONFIG) {
+            applyConfig(state, config, next);
+            continue;
+        }
+        if (buffer.rows + 2 > DATASET_CHUNK_ROWS) { // A frame's rows stay in one chunk
+            writer.write(buffer);
+            buffer.rows = 0;
+        }
+        uint32_t first = buffer.rows;
+        for (int p = 0; p < 2 && !state.gameOver; ++p) {
+            const Player& player = state.players[p];
+            if (!player.alive) continue;
+            uint32_t row = buffer.rows++;
+            buffer.set(COL_REPLAY, row, index);
+            buffer.set(COL_FRAME, row, frameIndex);
+            buffer.set(COL_PLAYER, row, static_cast<uint8_t>(p));
+            buffer.set(COL_DT, row, frame.dt);
+            buffer.set(COL_SIM_TIME, row, state.simTimeUs);
+            buffer.set(COL_POS_X, row, player.pos.x);
+            buffer.set(COL_POS_Y, row, player.pos.y);
+            buffer.set(COL_DIR_X, row, player.direction.x);
+            buffer.set(COL_DIR_Y, row, player.direction.y);
+            buffer.set(COL_SCORE, row, static_cast<uint32_t>(state.scores[p]));
+            buffer.set(COL_OPPONENT_SCORE, row, static_cast<uint32_t>(state.scores[1 - p]));
+            observeFeatures(state, config, p, probe, observation);
+            for (int i = 0; i < ENV_OBS_SIZE; ++i) buffer.set(COL_OBSERVATION + i, row, observation[i]);
+            buffer.set(COL_LEFT_TRIGGER, row, frame.triggers[p][0]);
+            buffer.set(COL_RIGHT_TRIGGER, row, frame.triggers[p][1]);
+        }
+        PlayerInput inputs[2] = {{frame.triggers[0][0], frame.triggers[0][1]}, {frame.triggers[1][0], frame.triggers[1][1]}};
+        stepGame(state, config, inputs, frame.dt, *collision);
+        for (uint32_t row = first; row < buffer.rows; ++row) {
+            int p = buffer.columns[COL_PLAYER][row];
+            buffer.set(COL_DIED, row, static_cast<uint8_t>(!state.players[p].alive));
+        }
+        frameIndex++;
+    }
+    if (buffer.rows) writer.write(buffer);
+    return true;
+}
+
+} // namespace
+
+size_t datasetTypeSize(uint32_t type) {
+    switch (type) {
+    case DATASET_U8: return 1;
+    case DATASET_I16: return 2;
+    case DATASET_U32: return 4;
+    case DATASET_F32: return 4;
+    case DATASET_U64: return 8;
+    default: return 0;
+    }
+}
+
+bool DatasetView::open(const uint8_t* data, size_t size) {
+    header = nullptr;
+    if (reinterpret_cast<uintptr_t>(data) % sizeof(uint64_t) != 0 || size < sizeof(DatasetHeader)) return false;
+    const DatasetHeader* candidate = reinterpret_cast<const DatasetHeader*>(data);
+    if (candidate->magic != DATASET_MAGIC || candidate->version != DATASET_VERSION || candidate->size != size) return false;
+    uint32_t columnCount = candidate->columnCount;
+    uint64_t chunkCount = candidate->chunkCount, directory = candidate->directoryOffset;
+    if (columnCount == 0 || columnCount > MAX_COLUMNS || candidate->chunkRows == 0) return false;
+    if (directory < sizeof(DatasetHeader) || directory > size || directory % sizeof(uint64_t) != 0) return false;
+
+    // The directory fills the rest of the file exactly; checked a part at a time so nothing overflows
+    uint64_t remaining = size - directory;
+    if (remaining < columnCount * sizeof(DatasetColumn)) return false;
+    remaining -= columnCount * sizeof(DatasetColumn);
+    if (chunkCount > remaining / sizeof(DatasetChunk)) return false;
+    remaining -= chunkCount * sizeof(DatasetChunk);
+    if (chunkCount && columnCount > remaining / sizeof(uint64_t) / chunkCount) return false;
+    if (remaining != chunkCount * columnCount * sizeof(uint64_t)) return false;
+
+    const DatasetColumn* columnTable = reinterpret_cast<const DatasetColumn*>(data + directory);
+    const DatasetChunk* chunkTable = reinterpret_cast<const DatasetChunk*>(columnTable + columnCount);
+    const uint64_t* offsetTable = reinterpret_cast<const uint64_t*>(chunkTable + chunkCount);
+    for (uint32_t c = 0; c < columnCount; ++c) {
+        if (!datasetTypeSize(columnTable[c].type) || columnTable[c].name[sizeof(columnTable[c].name) - 1] != 0) return false;
+    }
+    uint64_t rowsSoFar = 0;
+    for (uint64_t k = 0; k < chunkCount; ++k) {
+        const DatasetChunk& chunk = chunkTable[k];
+        if (chunk.firstRow != rowsSoFar || chunk.rows > candidate->chunkRows) return false;
+        rowsSoFar += chunk.rows;
+        for (uint32_t c = 0; c < columnCount; ++c) {
+            uint64_t offset = offsetTable[k * columnCount + c];
+            if (offset % DATASET_ALIGN != 0 || offset < sizeof(DatasetHeader) || offset > directory ||
+                static_cast<uint64_t>(chunk.rows) * datasetTypeSize(columnTable[c].type) > directory - offset) return false; // 64-bit on 32-bit size_t too
+        }
+    }
+    if (rowsSoFar != candidate->rowCount) return false;
+    base = data;
+    columnList = columnTable;
+    chunkList = chunkTable;
+    offsets = offsetTable;
+    header = candidate;
+    return true;
+}
+
+int DatasetView::column(const std::string& name) const {
+    for (int i = 0; i < columns(); ++i) {
+        if (name == columnList[i].name) return i;
+    }
+    return -1;
+}
+
+bool exportDataset(const std::vector<std::string>& replays, const std::string& outPath, int threads, DatasetStats& stats) {
+    stats = DatasetStats();
+    ChunkWriter writer;
+    if (!writer.open(outPath)) {
+        std::fprintf(stderr, "export: cannot write %s\n", outPath.c_str());
+        return false;
+    }
+    std::atomic<size_t> next(0);
+    std::atomic<int> exported(0), failed(0);
+    auto work = [&]() {
+        ChunkBuffer buffer;
+        std::string error;
+        size_t i;
+        while ((i = next++) < replays.size()) {
+            if (exportReplay(replays[i], static_cast<uint32_t>(i), buffer, writer, error)) {
+                exported++;
+            } else {
+                std::fprintf(stderr, "export: %s: %s\n", replays[i].c_str(), error.c_str());
+                failed++;
+            }
+        }
+    };
+#ifndef LINES_NO_THREADS
+    threads = std::max(1, std::min(threads, static_cast<int>(replays.size())));
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t) workers.emplace_back(work);
+    work();
+    for (auto& worker : workers) worker.join();
+#else
+    (void)threads;
+    work();
+#endif
+    stats.replays = exported;
+    stats.failed = failed;
+    if (!writer.finish(stats)) {
+        std::fprintf(stderr, "export: error writing %s\n", outPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+int runExport(const std::string& listPath, const std::string& outPath, int threads) {
+    std::ifstream list(listPath);
+    if (!list) {
+        std::fprintf(stderr, "export: cannot read %s\n", listPath.c_str());
+        return 1;
+    }
+    std::vector<std::string> replays;
+    std::string line;
+    while (std::getline(list, line)) {
+        line = line.substr(0, line.find('#'));
+        size_t begin = line.find_first_not_of(" \t\r"), end = line.find_last_not_of(" \t\r");
+        if (begin != std::string::npos) replays.push_back(line.substr(begin, end + 1 - begin));
+    }
+    if (replays.empty()) {
+        std::fprintf(stderr, "export: no replays in %s\n", listPath.c_str());
+        return 1;
+    }
+    DatasetStats stats;
+    if (!exportDataset(replays, outPath, threads, stats)) return 1;
+    std::fprintf(stderr, "export: %d replays (%d failed), %llu rows, %.1f MB to %s\n", stats.replays, stats.failed,
+                 static_cast<unsigned long long>(stats.rows), stats.bytes / 1048576.0, outPath.c_str());
+    return stats.failed ? 1 : 0;
+}
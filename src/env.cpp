@@ -0,0 +1,124 @@
+#include "env.h"
+#include "jobs.h"
+#include <cmath>
+#include <memory>
+
+namespace {
+
+const size_t MATCH_GRAIN = 4; // Matches per job; a tick is tens of microseconds
+
+float freeDistance(const GameState& state, int player, CollisionBackend& collision, const Vec2& from, float angle) {
+    Vec2 dir(std::cos(angle), std::sin(angle));
+    for (float d = ENV_RAY_STEP; d <= ENV_RAY_RANGE; d += ENV_RAY_STEP) {
+        Vec2 p = from + dir * d;
+        if (p.x < 0 || p.x > WIDTH || p.y < 0 || p.y > HEIGHT) return d;
+        if (collision.hit(state, player, p)) return d;
+    }
+    return ENV_RAY_RANGE;
+}
+
+} // namespace
+
+void observeFeatures(const GameState& state, const GameConfig& config, int player, CollisionBackend& collision, float* out) {
+    const Player& self = state.players[player];
+    const Player& other = state.players[1 - player];
+    Vec2 ahead = self.direction, right(-self.direction.y, self.direction.x);
+    // Into the head's frame, in arena widths
+    auto local = [&](const Vec2& at, float* into) {
+        float dx = at.x - self.pos.x, dy = at.y - self.pos.y;
+        into[0] = (dx * ahead.x + dy * ahead.y) / WIDTH;
+        into[1] = (dx * right.x + dy * right.y) / WIDTH;
+    };
+    out[0] = self.alive ? 1.0f : 0.0f;
+    local(state.collectible.pos, out + 1);
+    local(other.pos, out + 3);
+    out[5] = other.direction.x * ahead.x + other.direction.y * ahead.y;
+    out[6] = other.direction.x * right.x + other.direction.y * right.y;
+    const Circle* nearest = nullptr;
+    float nearestDistance = 0;
+    for (const auto& circle : state.circles) {
+        float dx = circle.pos.x - self.pos.x, dy = circle.pos.y - self.pos.y;
+        float distance = dx * dx + dy * dy;
+        if (!nearest || distance < nearestDistance) {
+            nearest = &circle;
+            nearestDistance = distance;
+        }
+    }
+    if (nearest) {
+        local(nearest->pos, out + 7);
+        out[9] = (nearest->vel.x * ahead.x + nearest->vel.y * ahead.y) / config.circleSpeed;
+        out[10] = (nearest->vel.x * right.x + nearest->vel.y * right.y) / config.circleSpeed;
+    } else {
+        out[7] = out[8] = out[9] = out[10] = 0.0f;
+    }
+    float heading = std::atan2(self.direction.y, self.direction.x);
+    for (int r = 0; r < ENV_RAY_COUNT; ++r) out[11 + r] = freeDistance(state, player, collision, self.pos, heading + ENV_RAY_ANGLES[r]) / ENV_RAY_RANGE;
+}
+
+VecEnv::VecEnv(const GameConfig& config, JobSystem& jobs, float tickRate, float maxRoundSeconds)
+    : config(config), jobs(jobs), dt(1.0f / tickRate), maxRoundUs(secondsToUs(maxRoundSeconds)) {}
+
+void VecEnv::reset(int batch, uint32_t seed) {
+    matches.resize(batch);
+    observationData.assign(static_cast<size_t>(batch) * 2 * ENV_OBS_SIZE, 0.0f);
+    rewardData.assign(static_cast<size_t>(batch) * 2, 0.0f);
+    doneData.assign(batch, 0);
+    jobs.parallelFor(batch, MATCH_GRAIN, [this, seed](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            newGame(matches[i], config, seed + static_cast<uint32_t>(i));
+            observe(static_cast<int>(i));
+        }
+    });
+}
+
+EnvStep VecEnv::step(const PlayerInput* actions) {
+    jobs.parallelFor(matches.size(), MATCH_GRAIN, [this, actions](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) stepMatch(static_cast<int>(i), actions);
+    });
+    return EnvStep{observationData.data(), rewardData.data(), doneData.data()};
+}
+
+void VecEnv::stepMatch(int index, const PlayerInput* actions) {
+    GameState& state = matches[index];
+    int before[2] = {state.scores[0], state.scores[1]};
+    int events = stepGame(state, config, actions + index * 2, dt, collision);
+    float gained = static_cast<float>((state.scores[0] - before[0]) - (state.scores[1] - before[1]));
+    rewardData[index * 2] = gained;
+    rewardData[index * 2 + 1] = -gained;
+    bool done = (events & GAME_EVENT_ROUND_OVER) || state.simTimeUs - state.roundStartUs >= maxRoundUs;
+    if (done) { // Straight into the next round, as the sweep does
+        state.scheduler.cancel(state.countdownTimer);
+        state.countdownTimer = INVALID_TIMER;
+        state.scheduler.cancel(state.spawnTimer);
+        resetRound(state, config);
+    }
+    doneData[index] = done;
+    observe(index);
+}
+
+void VecEnv::observe(int index) {
+    for (int p = 0; p < 2; ++p) observeFeatures(matches[index], config, p, collision, &observationData[(static_cast<size_t>(index) * 2 + p) * ENV_OBS_SIZE]);
+}
+
+template <typename Out>
+void VecEnv::observeGridsInto(Out* out, int level) const {
+    jobs.parallelFor(matches.size(), MATCH_GRAIN, [this, out, level](size_t begin, size_t end) {
+        static LINES_THREAD_LOCAL std::unique_ptr<OccupancyMap> map; // One per thread, kept between calls
+        if (!map) map.reset(new OccupancyMap());
+        for (size_t i = begin; i < end; ++i) {
+            const GameState& state = matches[i];
+            map->build(state);
+            ObservationHead heads[2];
+            for (int p = 0; p < 2; ++p) heads[p] = ObservationHead{map.get(), state.players[p].pos, state.players[p].direction};
+            observeHeads(heads, 2, out + i * 2 * OBS_GRID_CELLS, level);
+        }
+    });
+}
+
+void VecEnv::observeGrids(float* out, int level) const {
+    observeGridsInto(out, level);
+}
+
+void VecEnv::observeGrids(uint8_t* out, int level) const {
+    observeGridsInto(out, level);
+}
@@ -0,0 +1,332 @@
+#include "game.h"
+#include "jobs.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+
+void spawnCircle(GameState& state, const GameConfig& config) {
+    Rng& rng = state.rng[RNG_CIRCLES];
+    float angle = rng.uniform(0, 2 * M_PI);
+    float x = rng.uniform(50, WIDTH - 50), y = rng.uniform(50, HEIGHT - 50);
+    state.circles.push_back(Circle{Vec2(x, y), Vec2(config.circleSpeed * cos(angle), config.circleSpeed * sin(angle)), config.circleRadius});
+}
+
+Collectible spawnCollectible(Rng& rng, const GameConfig& config) {
+    // Use black square size for spawn boundaries to ensure it fits
+    float blackSquareSize = config.blackSquareSize();
+    float x = rng.uniform(blackSquareSize / 2, WIDTH - blackSquareSize / 2);
+    float y = rng.uniform(blackSquareSize / 2, HEIGHT - blackSquareSize / 2);
+    return Collectible{Vec2(x, y), config.collectibleSize, config.blackCircleSize(), blackSquareSize};
+}
+
+} // namespace
+
+uint64_t secondsToUs(float seconds) {
+    return static_cast<uint64_t>(seconds * 1000000.0f);
+}
+
+int CpuCollision::hit(const GameState& state, int player, const Vec2& pos) {
+    // Pixel centers sampled by the readback test, clipped to the screen
+    int half = COLLISION_CHECK_SIZE / 2;
+    float cx = std::floor(pos.x) + 0.5f, cy = std::floor(pos.y) + 0.5f;
+    float minX = std::max(cx - half, 0.5f), maxX = std::min(cx + half, WIDTH - 0.5f);
+    float minY = std::max(cy - half, 0.5f), maxY = std::min(cy + half, HEIGHT - 0.5f);
+    if (minX > maxX || minY > maxY) return HIT_NONE;
+
+    // Only the tiles a trail quad touching the area can have landed in
+    const float trailHalf = TRAIL_SIZE / 2.0f;
+    int tx0 = Trail::tileX(minX - trailHalf), tx1 = Trail::tileX(maxX + trailHalf);
+    int ty0 = Trail::tileY(minY - trailHalf), ty1 = Trail::tileY(maxY + trailHalf);
+    for (int i = 0; i < 2; ++i) {
+        const Trail& trail = state.players[i].trail;
+        for (int ty = ty0; ty <= ty1; ++ty) {
+            for (int tx = tx0; tx <= tx1; ++tx) {
+                for (const auto& point : trail.tile(ty * TRAIL_TILES_X + tx)) {
+                    if (i == player && trail.recent(point, SELF_TRAIL_SKIP)) continue;
+                    const Vec2& p = point.pos;
+                    if (p.x - trailHalf <= maxX && p.x + trailHalf > minX &&
+                        p.y - trailHalf <= maxY && p.y + trailHalf > minY) return HIT_TRAIL + i;
+                }
+            }
+        }
+    }
+    for (const auto& circle : state.circles) {
+        float dx = circle.pos.x - std::max(minX, std::min(circle.pos.x, maxX));
+        float dy = circle.pos.y - std::max(minY, std::min(circle.pos.y, maxY));
+        if (dx * dx + dy * dy < circle.radius * circle.radius) return HIT_CIRCLE;
+    }
+    return HIT_NONE;
+}
+
+void LateCollision::prepare(const GameState& state, const Vec2 heads[2], const bool active[2]) {
+    ++tick;
+    inner.prepare(state, heads, active);
+}
+
+int LateCollision::hit(const GameState& state, int player, const Vec2& pos) {
+    Pending& last = pending[player];
+    bool current = last.tick + 1 == tick && last.round == state.roundStartUs && last.timeUs <= state.simTimeUs;
+    int result = current ? last.source : HIT_NONE;
+    last.source = inner.hit(state, player, pos);
+    last.tick = tick;
+    last.round = state.roundStartUs;
+    last.timeUs = state.simTimeUs;
+    return result;
+}
+
+void newGame(GameState& state, const GameConfig& config, uint32_t seed) {
+    for (int i = 0; i < RNG_STREAM_COUNT; ++i) state.rng[i].seed(seed, i);
+    state.scheduler.reset();
+    state.simTimeUs = 0;
+    state.scores[0] = state.scores[1] = 0;
+    state.countdown = 0;
+    state.countdownTimer = INVALID_TIMER;
+    resetRound(state, config);
+}
+
+void resetRound(GameState& state, const GameConfig& config) {
+    state.players[0] = Player{Vec2(200, HEIGHT / 2), Vec2(1, 0), {0, 0, 255, 255}, {}, true, false, false, HIT_NONE}; // Blue
+    state.players[1] = Player{Vec2(WIDTH - 200, HEIGHT / 2), Vec2(-1, 0), {255, 0, 0, 255}, {}, true, false, false, HIT_NONE}; // Red
+    state.circles.clear();
+    spawnCircle(state, config);
+    state.collectible = spawnCollectible(state.rng[RNG_COLLECTIBLES], config);
+    state.gameOver = false;
+    state.roundStartUs = state.simTimeUs;
+    state.spawnTimer = state.scheduler.scheduleRepeating(secondsToUs(config.circleSpawnInterval), TIMER_SPAWN_CIRCLE);
+}
+
+void applyConfig(GameState& state, GameConfig& config, const GameConfig& next) {
+    bool respawn = next.circleSpawnInterval != config.circleSpawnInterval;
+    config = next; // Plain data, nothing reallocates
+    if (respawn && state.scheduler.cancel(state.spawnTimer)) {
+        state.spawnTimer = state.scheduler.scheduleRepeating(secondsToUs(config.circleSpawnInterval), TIMER_SPAWN_CIRCLE);
+    }
+}
+
+bool checkCollectibleCollision(const Vec2& playerPos, const Collectible& collectible) {
+    float halfSize = collectible.size / 2;
+    return playerPos.x >= collectible.pos.x - halfSize &&
+           playerPos.x <= collectible.pos.x + halfSize &&
+           playerPos.y >= collectible.pos.y - halfSize &&
+           playerPos.y <= collectible.pos.y + halfSize;
+}
+
+namespace {
+
+// Everything one tick's tasks share. Each task writes only its own slots, so
+// the result does not depend on how the tasks were scheduled.
+struct TickContext {
+    GameState& state;
+    const GameConfig& config;
+    const PlayerInput* inputs;
+    float dt;
+    CollisionBackend& collision;
+    std::vector<Circle>& movedCircles; // Circle positions after this tick
+    Vec2 nextPos[2];
+    bool checkHit[2]; // Needs a trail/circle collision test this tick
+    int hit[2]; // HitSource
+    int events;
+};
+
+const size_t CIRCLES_PER_TASK = 64;
+
+bool outsideArena(const Vec2& pos) {
+    return pos.x < 0 || pos.x > WIDTH || pos.y < 0 || pos.y > HEIGHT;
+}
+
+void steerPlayer(TickContext& tick, int i) {
+    Player& player = tick.state.players[i];
+    tick.checkHit[i] = false;
+    tick.hit[i] = HIT_NONE;
+    if (!player.alive) return;
+
+    // Trigger input for steering
+    int leftTrigger = tick.inputs[i].leftTrigger, rightTrigger = tick.inputs[i].rightTrigger;
+    if (leftTrigger > 0 || rightTrigger > 0) player.hasMoved = true; // Mark as moved on trigger press
+    float turn = (rightTrigger - leftTrigger) / 32768.0f * tick.config.turnSpeed * tick.dt;
+    float angle = atan2(player.direction.y, player.direction.x) + turn;
+    player.direction = Vec2(cos(angle), sin(angle));
+
+    tick.nextPos[i] = player.pos + player.direction * tick.config.playerSpeed * tick.dt;
+    tick.checkHit[i] = !player.willDie && !outsideArena(tick.nextPos[i]) && player.hasMoved; // Trail/circle collision only if hasMoved
+}
+
+// Both heads test against the arena as it was at the start of the tick
+void collidePlayer(TickContext& tick, int i) {
+    if (tick.checkHit[i]) tick.hit[i] = tick.collision.hit(tick.state, i, tick.nextPos[i]);
+}
+
+void moveCircles(TickContext& tick, size_t begin, size_t end) {
+    for (size_t k = begin; k < end; ++k) {
+        Circle circle = tick.state.circles[k];
+        circle.pos = circle.pos + circle.vel * tick.dt;
+        if (circle.pos.x - circle.radius < 0 || circle.pos.x + circle.radius > WIDTH) {
+            circle.vel.x = -circle.vel.x;
+            circle.pos.x = std::max(circle.radius, std::min(WIDTH - circle.radius, circle.pos.x));
+        }
+        if (circle.pos.y - circle.radius < 0 || circle.pos.y + circle.radius > HEIGHT) {
+            circle.vel.y = -circle.vel.y;
+            circle.pos.y = std::max(circle.radius, std::min(HEIGHT - circle.radius, circle.pos.y));
+        }
+        tick.movedCircles[k] = circle;
+    }
+}
+
+// Serial: collectible respawns draw from the shared RNG in player order
+void commitPlayers(TickContext& tick) {
+    GameState& state = tick.state;
+    for (int i = 0; i < 2; ++i) {
+        Player* player = &state.players[i];
+        if (!player->alive) continue;
+
+        if (!player->willDie) {
+            // Check wall collision (always applies), then the trail/circle test from collidePlayer
+            if (outsideArena(tick.nextPos[i])) player->killedBy = HIT_WALL;
+            else if (tick.hit[i] != HIT_NONE) player->killedBy = tick.hit[i];
+            player->willDie = player->killedBy != HIT_NONE;
+        } else {
+            player->alive = false;
+            continue;
+        }
+
+        // Move and add trail
+        player->pos = tick.nextPos[i];
+        if (player->willDie) player->trail.push(player->pos); // Where it ended, however close
+        else player->trail.sample(player->pos, player->direction);
+
+        // Check collectible collision (allowed even if invincible)
+        if (checkCollectibleCollision(player->pos, state.collectible)) {
+            state.scores[i]++;
+            state.collectible = spawnCollectible(state.rng[RNG_COLLECTIBLES], tick.config);
+            tick.events |= GAME_EVENT_COLLECTIBLE;
+        }
+    }
+    state.circles.swap(tick.movedCircles); // Collision is done reading the old positions
+}
+
+const size_t TILES_PER_TASK = 16;
+
+// Edge of a tile's bounds; outer tiles also hold points past the arena edge
+float tileEdge(int index, int count) {
+    if (index <= 0) return -FLT_MAX;
+    if (index >= count) return FLT_MAX;
+    return static_cast<float>(index * TRAIL_TILE_SIZE);
+}
+
+// Each tile is only touched by the task that owns it, with every circle
+// overlapping it applied in one pass
+void eraseTiles(GameState& state, size_t begin, size_t end) {
+    static LINES_THREAD_LOCAL std::vector<const Circle*> overlapping;
+    for (size_t t = begin; t < end; ++t) {
+        int index = static_cast<int>(t);
+        if (state.players[0].trail.tile(index).empty() && state.players[1].trail.tile(index).empty()) continue;
+        int tx = index % TRAIL_TILES_X, ty = index / TRAIL_TILES_X;
+        float minX = tileEdge(tx, TRAIL_TILES_X), maxX = tileEdge(tx + 1, TRAIL_TILES_X);
+        float minY = tileEdge(ty, TRAIL_TILES_Y), maxY = tileEdge(ty + 1, TRAIL_TILES_Y);
+        overlapping.clear();
+        for (const auto& circle : state.circles) {
+            float dx = circle.pos.x - std::max(minX, std::min(circle.pos.x, maxX));
+            float dy = circle.pos.y - std::max(minY, std::min(circle.pos.y, maxY));
+            float reach = circle.radius + 1; // Slack so rounding never skips a tile the exact test would erase in
+            if (dx * dx + dy * dy < reach * reach) overlapping.push_back(&circle);
+        }
+        if (overlapping.empty()) continue;
+        for (auto& player : state.players) {
+            player.trail.eraseIf(index, [](const TrailPoint& point) {
+                for (const Circle* circle : overlapping) {
+                    float dx = circle->pos.x - point.pos.x, dy = circle->pos.y - point.pos.y;
+                    if (sqrt(dx * dx + dy * dy) < circle->radius) return true;
+                }
+                return false;
+            });
+        }
+    }
+}
+
+} // namespace
+
+void eraseTrails(GameState& state, JobSystem* jobs) {
+    if (!jobs) {
+        eraseTiles(state, 0, TRAIL_TILE_COUNT);
+        return;
+    }
+    jobs->parallelFor(TRAIL_TILE_COUNT, TILES_PER_TASK, [&state](size_t begin, size_t end) { eraseTiles(state, begin, end); });
+}
+
+// Per tick task graph (stepGame):
+//   steer[0,1] --> prepare --> collide[i] --+
+//                                           +--> commitPlayers --> erase[16-tile chunks]
+//   moveCircles[64 circle chunks] ----------+
+int stepGame(GameState& state, const GameConfig& config, const PlayerInput inputs[2], float dt, CollisionBackend& collision, JobSystem* jobs) {
+    static LINES_THREAD_LOCAL std::vector<Circle> movedCircles;
+    TickContext tick{state, config, inputs, dt, collision, movedCircles, {}, {}, {}, 0};
+    state.simTimeUs += secondsToUs(dt);
+
+    if (!state.gameOver) {
+        movedCircles.resize(state.circles.size());
+    }
+    if (!state.gameOver && !jobs) {
+        // Same tasks in a fixed order, without building a graph (headless tools)
+        for (int i = 0; i < 2; ++i) steerPlayer(tick, i);
+        collision.prepare(state, tick.nextPos, tick.checkHit);
+        for (int i = 0; i < 2; ++i) collidePlayer(tick, i);
+        moveCircles(tick, 0, state.circles.size());
+        commitPlayers(tick);
+        eraseTiles(state, 0, TRAIL_TILE_COUNT);
+    } else if (!state.gameOver) {
+        TaskGraph graph;
+        bool pinned = !collision.concurrent(); // GL readback stays on the calling thread
+        TaskGraph::Task commit = graph.add([&tick] { commitPlayers(tick); });
+        TaskGraph::Task prepare = graph.add([&tick] { tick.collision.prepare(tick.state, tick.nextPos, tick.checkHit); }, pinned);
+        for (int i = 0; i < 2; ++i) {
+            TaskGraph::Task steer = graph.add([&tick, i] { steerPlayer(tick, i); });
+            TaskGraph::Task collide = graph.add([&tick, i] { collidePlayer(tick, i); }, pinned);
+            graph.depend(prepare, steer);
+            graph.depend(collide, prepare);
+            graph.depend(commit, collide);
+        }
+        for (size_t begin = 0; begin < TRAIL_TILE_COUNT; begin += TILES_PER_TASK) {
+            size_t end = std::min(begin + TILES_PER_TASK, static_cast<size_t>(TRAIL_TILE_COUNT));
+            graph.depend(graph.add([&state, begin, end] { eraseTiles(state, begin, end); }), commit);
+        }
+        for (size_t begin = 0; begin < state.circles.size(); begin += CIRCLES_PER_TASK) {
+            size_t end = std::min(begin + CIRCLES_PER_TASK, state.circles.size());
+            graph.depend(commit, graph.add([&tick, begin, end] { moveCircles(tick, begin, end); }));
+        }
+        jobs->run(graph);
+    }
+
+    if (!state.gameOver) {
+        // Check game over
+        bool alive1 = state.players[0].alive, alive2 = state.players[1].alive;
+        if (!alive1 || !alive2) {
+            state.gameOver = true;
+            state.scheduler.cancel(state.spawnTimer);
+            state.countdown = config.gameOverCountdown;
+            state.countdownTimer = state.scheduler.scheduleRepeating(1000000, TIMER_COUNTDOWN);
+            if (!alive1 && alive2) state.scores[1] += 3; // Player1 dies, Player2 gets 3 points
+            else if (!alive2 && alive1) state.scores[0] += 3; // Player2 dies, Player1 gets 3 points
+            // No points if both die
+            tick.events |= GAME_EVENT_ROUND_OVER;
+        }
+    }
+
+    // Fire timed events (circle spawns, game over countdown)
+    state.scheduler.advance(state.simTimeUs, [&](const Timer& timer) {
+        switch (timer.type) {
+        case TIMER_SPAWN_CIRCLE:
+            spawnCircle(state, config);
+            break;
+        case TIMER_COUNTDOWN:
+            if (--state.countdown > 0) break;
+            state.scheduler.cancel(state.countdownTimer);
+            state.countdownTimer = INVALID_TIMER;
+            resetRound(state, config);
+            tick.events |= GAME_EVENT_ROUND_START;
+            break;
+        }
+    });
+    return tick.events;
+}
@@ -0,0 +1,250 @@
+#include "glcollision.h"
+#include "glfuncs.h"
+#include "glstate.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+bool checkPixelCollision(const Vec2& pos) {
+    GLubyte pixel[3];
+    glState.readPixels((int)pos.x, HEIGHT - (int)pos.y, 1, 1, GL_RGB, pixel);
+    return !(pixel[0] == 0 && pixel[1] == 0 && pixel[2] == 0); // Not black
+}
+
+bool checkAreaCollision(const Vec2& center, int size) {
+    int halfSize = size / 2;
+    for (int dx = -halfSize; dx <= halfSize; dx++) {
+        for (int dy = -halfSize; dy <= halfSize; dy++) {
+            Vec2 checkPos(center.x + dx, center.y + dy);
+            if (checkPos.x < 0 || checkPos.x >= WIDTH || checkPos.y < 0 || checkPos.y >= HEIGHT) continue;
+            if (checkPixelCollision(checkPos)) return true;
+        }
+    }
+    return false;
+}
+
+// Id target values past the HitSources: a player's newest points, which only
+// that player's own head ignores
+const int ID_RECENT = 16;
+
+// Draw order in the id target, last on top: newest points must not hide
+// anything else
+enum IdLayer {
+    ID_LAYER_RECENT,
+    ID_LAYER_TRAILS,
+    ID_LAYER_CIRCLES
+};
+
+Color idColor(int id) {
+    return Color{static_cast<uint8_t>(id), 0, 0, 255};
+}
+
+// Stencil bits: everything but the newest own points, then each player's newest
+const GLuint STENCIL_BASE = 1;
+const GLuint STENCIL_RECENT[2] = {2, 4};
+
+void submitStencil(RenderList& list, GLuint bit) {
+    glState.stencilFunc(GL_ALWAYS, bit, bit);
+    glState.stencilMask(bit);
+    submitRenderList(list);
+}
+
+} // namespace
+
+int ReadbackCollision::hit(const GameState& state, int player, const Vec2& pos) {
+    list.clear();
+    drawTrail(list, LAYER_TRAILS, state.players[0], player == 0 ? SELF_TRAIL_SKIP : 0); // Skip last 5 points for self
+    drawTrail(list, LAYER_TRAILS + 1, state.players[1], player == 1 ? SELF_TRAIL_SKIP : 0);
+    for (const auto& circle : state.circles) drawCircle(list, LAYER_CIRCLES, circle.pos.x, circle.pos.y, circle.radius, {255, 255, 0, 255});
+    glState.clear(GL_COLOR_BUFFER_BIT);
+    submitRenderList(list);
+    return checkAreaCollision(pos, COLLISION_CHECK_SIZE) ? HIT_UNKNOWN : HIT_NONE;
+}
+
+bool OcclusionCollision::init() {
+    if (!glFuncs.occlusionQueries()) return false;
+    GLint stencilBits = 0;
+    glGetIntegerv(GL_STENCIL_BITS, &stencilBits);
+    if (stencilBits < 3) return false;
+    GLuint ids[2];
+    glFuncs.genQueries(2, ids); // Freed with the context
+    for (int i = 0; i < 2; ++i) probes[i].query = ids[i];
+    return true;
+}
+
+void OcclusionCollision::fillStencil(const GameState& state) {
+    const float halfSize = TRAIL_SIZE / 2.0f;
+    base.clear();
+    for (int i = 0; i < 2; ++i) {
+        const Player& player = state.players[i];
+        recent[i].clear();
+        for (int t = 0; t < TRAIL_TILE_COUNT; ++t) {
+            for (const auto& point : player.trail.tile(t)) {
+                RenderList& list = player.trail.recent(point, SELF_TRAIL_SKIP) ? recent[i] : base;
+                list.square(LAYER_TRAILS + i, player.color, point.pos.x - halfSize, point.pos.y - halfSize, TRAIL_SIZE);
+            }
+        }
+    }
+    for (const auto& circle : state.circles) drawCircle(base, LAYER_CIRCLES, circle.pos.x, circle.pos.y, circle.radius, {255, 255, 0, 255});
+
+    glState.stencilMask(0xff);
+    glState.clear(GL_STENCIL_BUFFER_BIT);
+    glState.stencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+    submitStencil(base, STENCIL_BASE);
+    submitStencil(recent[0], STENCIL_RECENT[0]);
+    submitStencil(recent[1], STENCIL_RECENT[1]);
+    filled = true;
+}
+
+void OcclusionCollision::prepare(const GameState& state, const Vec2 heads[2], const bool active[2]) {
+    (void)state;
+    (void)heads;
+    (void)active;
+    filled = false;
+    ++tick; // A head that skips a tick leaves its probe two ticks old
+}
+
+int OcclusionCollision::hit(const GameState& state, int player, const Vec2& pos) {
+    // Last tick's probe; it has had a whole frame to finish, so this rarely waits
+    Probe& probe = probes[player];
+    bool result = false;
+    // Ticks are counted rather than compared by time, so dt == 0 keeps the probe
+    if (probe.pending && probe.tick + 1 == tick && probe.round == state.roundStartUs && probe.timeUs <= state.simTimeUs) {
+        GLuint samples = 0;
+        glFuncs.getQueryObjectuiv(probe.query, GL_QUERY_RESULT, &samples);
+        result = samples > 0;
+    }
+
+    glState.colorMask(false); // Nothing here reaches the screen
+    glState.enable(GL_STENCIL_TEST, true);
+    // Both heads test the arena as it was at the start of the tick
+    if (!filled) fillStencil(state);
+
+    // Covers the same pixel centers CpuCollision samples
+    int half = COLLISION_CHECK_SIZE / 2;
+    float x0 = std::floor(pos.x) - half, y0 = std::floor(pos.y) - half;
+    float x1 = x0 + COLLISION_CHECK_SIZE, y1 = y0 + COLLISION_CHECK_SIZE;
+    glState.stencilMask(0);
+    glState.stencilFunc(GL_NOTEQUAL, 0, STENCIL_BASE | STENCIL_RECENT[1 - player]);
+    glFuncs.beginQuery(GL_SAMPLES_PASSED, probe.query);
+    glState.begin(GL_QUADS);
+    glState.vertex(x0, y0);
+    glState.vertex(x1, y0);
+    glState.vertex(x1, y1);
+    glState.vertex(x0, y1);
+    glState.flush();
+    glFuncs.endQuery(GL_SAMPLES_PASSED);
+    probe.pending = true;
+    probe.tick = tick;
+    probe.round = state.roundStartUs;
+    probe.timeUs = state.simTimeUs;
+
+    glState.stencilMask(0xff);
+    glState.enable(GL_STENCIL_TEST, false);
+    glState.colorMask(true);
+    return result ? HIT_UNKNOWN : HIT_NONE;
+}
+
+bool IdBufferCollision::init() {
+    if (!glFuncs.framebufferObjects()) return false;
+
+    GLuint renderbuffer;
+    glFuncs.genRenderbuffers(1, &renderbuffer); // Freed with the context
+    glFuncs.genFramebuffers(1, &framebuffer);
+    glFuncs.bindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+    glFuncs.bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFuncs.framebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffer);
+    // One byte per pixel where the driver has red-only targets, RGBA otherwise
+    while (glGetError() != GL_NO_ERROR) {}
+    glFuncs.renderbufferStorage(GL_RENDERBUFFER, GL_R8, TARGET_WIDTH, TARGET_HEIGHT);
+    bool complete = glGetError() == GL_NO_ERROR && glFuncs.checkFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (!complete) {
+        glFuncs.renderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, TARGET_WIDTH, TARGET_HEIGHT);
+        complete = glFuncs.checkFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    }
+    glFuncs.bindFramebuffer(GL_FRAMEBUFFER, 0);
+    glFuncs.bindRenderbuffer(GL_RENDERBUFFER, 0);
+    return complete;
+}
+
+IdBufferCollision::Rect IdBufferCollision::probeRect(const Vec2& pos) {
+    // The pixels CpuCollision samples, then every target pixel they fall in
+    int half = COLLISION_CHECK_SIZE / 2;
+    int x = static_cast<int>(std::floor(pos.x)), y = static_cast<int>(std::floor(pos.y));
+    Rect rect;
+    rect.x0 = std::max(0, (x - half) / SCALE);
+    rect.y0 = std::max(0, (y - half) / SCALE);
+    rect.x1 = std::min(TARGET_WIDTH - 1, (x + half) / SCALE);
+    rect.y1 = std::min(TARGET_HEIGHT - 1, (y + half) / SCALE);
+    return rect;
+}
+
+void IdBufferCollision::prepare(const GameState& state, const Vec2 heads[2], const bool active[2]) {
+    read = Rect{0, 0, -1, -1};
+    for (int i = 0; i < 2; ++i) {
+        if (!active[i]) continue;
+        Rect probe = probeRect(heads[i]);
+        if (read.x1 < read.x0) {
+            read = probe;
+            continue;
+        }
+        read.x0 = std::min(read.x0, probe.x0);
+        read.y0 = std::min(read.y0, probe.y0);
+        read.x1 = std::max(read.x1, probe.x1);
+        read.y1 = std::max(read.y1, probe.y1);
+    }
+    if (read.x1 < read.x0 || read.y1 < read.y0) return; // No head to test, nothing to draw
+
+    const float halfSize = TRAIL_SIZE / 2.0f;
+    list.clear();
+    for (int i = 0; i < 2; ++i) {
+        const Trail& trail = state.players[i].trail;
+        for (int t = 0; t < TRAIL_TILE_COUNT; ++t) {
+            for (const auto& point : trail.tile(t)) {
+                bool recent = trail.recent(point, SELF_TRAIL_SKIP);
+                list.square(recent ? ID_LAYER_RECENT : ID_LAYER_TRAILS, idColor(recent ? ID_RECENT + i : HIT_TRAIL + i),
+                            point.pos.x - halfSize, point.pos.y - halfSize, TRAIL_SIZE);
+            }
+        }
+    }
+    for (const auto& circle : state.circles) list.circle(ID_LAYER_CIRCLES, idColor(HIT_CIRCLE), circle.pos.x, circle.pos.y, circle.radius);
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glState.flush();
+    glFuncs.bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glState.viewport(0, 0, TARGET_WIDTH, TARGET_HEIGHT); // Same projection, so the arena shrinks to fit
+    glState.enable(GL_DITHER, false); // Ids have to come back exactly
+    glState.clearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glState.clear(GL_COLOR_BUFFER_BIT);
+    submitRenderList(list);
+
+    // GL rows count up from the bottom
+    int width = read.x1 - read.x0 + 1, height = read.y1 - read.y0 + 1;
+    ids.resize(static_cast<size_t>(width) * height);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glState.readPixels(read.x0, TARGET_HEIGHT - 1 - read.y1, width, height, GL_RED, ids.data());
+
+    glState.flush();
+    glFuncs.bindFramebuffer(GL_FRAMEBUFFER, 0);
+    glState.viewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glState.enable(GL_DITHER, true);
+    glState.clearColor(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+int IdBufferCollision::hit(const GameState& state, int player, const Vec2& pos) {
+    (void)state;
+    Rect probe = probeRect(pos);
+    int width = read.x1 - read.x0 + 1;
+    for (int y = probe.y0; y <= probe.y1; ++y) {
+        const uint8_t* row = ids.data() + static_cast<size_t>(read.y1 - y) * width;
+        for (int x = probe.x0; x <= probe.x1; ++x) {
+            int id = row[x - read.x0];
+            if (id == ID_RECENT + player) continue; // Own newest points
+            if (id >= ID_RECENT) return HIT_TRAIL + id - ID_RECENT;
+            if (id != HIT_NONE) return id;
+        }
+    }
+    return HIT_NONE;
+}
@@ -0,0 +1,59 @@
+#include "glfuncs.h"
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <string>
+
+GlFunctions glFuncs = {};
+
+namespace {
+
+// A non-null SDL_GL_GetProcAddress result does not mean the driver has the
+// function (GLX hands out stubs for any gl* name), so each group is loaded only
+// once GL_VERSION or the extension string says the context has it. suffix
+// picks the core names ("") or the extension's.
+template <typename Fn>
+void load(Fn& fn, const char* name, const char* suffix) {
+    fn = reinterpret_cast<Fn>(SDL_GL_GetProcAddress((std::string(name) + suffix).c_str()));
+}
+
+// major * 10 + minor of a desktop context; 0 for GL ES or an unreadable string,
+// which then only gets what its extensions list
+int contextVersion() {
+    const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    int major = 0, minor = 0;
+    if (!version || std::sscanf(version, "%d.%d", &major, &minor) != 2) return 0;
+    return major * 10 + minor;
+}
+
+bool extension(const char* name) {
+    return SDL_GL_ExtensionSupported(name) == SDL_TRUE;
+}
+
+} // namespace
+
+void loadGlFunctions() {
+    glFuncs = GlFunctions();
+    int version = contextVersion();
+
+    const char* queries = version >= 15 ? "" : extension("GL_ARB_occlusion_query") ? "ARB" : nullptr;
+    if (queries) {
+        load(glFuncs.genQueries, "glGenQueries", queries);
+        load(glFuncs.beginQuery, "glBeginQuery", queries);
+        load(glFuncs.endQuery, "glEndQuery", queries);
+        load(glFuncs.getQueryObjectuiv, "glGetQueryObjectuiv", queries);
+        // ARB_timer_query has no suffix of its own and works with either query API
+        if (version >= 33 || extension("GL_ARB_timer_query")) load(glFuncs.getQueryObjectui64v, "glGetQueryObjectui64v", "");
+    }
+
+    const char* framebuffers = version >= 30 || extension("GL_ARB_framebuffer_object") ? ""
+                               : extension("GL_EXT_framebuffer_object") ? "EXT" : nullptr;
+    if (framebuffers) {
+        load(glFuncs.genFramebuffers, "glGenFramebuffers", framebuffers);
+        load(glFuncs.bindFramebuffer, "glBindFramebuffer", framebuffers);
+        load(glFuncs.genRenderbuffers, "glGenRenderbuffers", framebuffers);
+        load(glFuncs.bindRenderbuffer, "glBindRenderbuffer", framebuffers);
+        load(glFuncs.renderbufferStorage, "glRenderbufferStorage", framebuffers);
+        load(glFuncs.framebufferRenderbuffer, "glFramebufferRenderbuffer", framebuffers);
+        load(glFuncs.checkFramebufferStatus, "glCheckFramebufferStatus", framebuffers);
+    }
+}
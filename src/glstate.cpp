@@ -0,0 +1,93 @@
+#include "glstate.h"
+
+GlState glState;
+
+void GlState::invalidate() {
+    batch = UNSET;
+    currentColor = NO_COLOR;
+    stencilTest = dither = colorWrite = -1;
+    stencilFn = UNSET;
+    stencilRef = -1;
+    stencilFnMask = stencilWriteMask = 0;
+    stencilWriteKnown = false;
+    stencilOps[0] = stencilOps[1] = stencilOps[2] = UNSET;
+    clearRgba[0] = clearRgba[1] = clearRgba[2] = clearRgba[3] = -1.0f;
+    view[0] = view[1] = view[2] = view[3] = -1;
+    frame = DrawStats();
+}
+
+void GlState::enable(GLenum cap, bool on) {
+    int* cached = cap == GL_STENCIL_TEST ? &stencilTest : cap == GL_DITHER ? &dither : nullptr;
+    if (cached && !changed(*cached != on)) return;
+    if (!cached) changed(true); // Not tracked, always sent
+    else *cached = on;
+    if (on) glEnable(cap);
+    else glDisable(cap);
+}
+
+void GlState::colorMask(bool on) {
+    if (!changed(colorWrite != on)) return;
+    colorWrite = on;
+    GLboolean write = on ? GL_TRUE : GL_FALSE;
+    glColorMask(write, write, write, write);
+}
+
+void GlState::stencilFunc(GLenum func, GLint ref, GLuint mask) {
+    if (!changed(func != stencilFn || ref != stencilRef || mask != stencilFnMask)) return;
+    stencilFn = func;
+    stencilRef = ref;
+    stencilFnMask = mask;
+    glStencilFunc(func, ref, mask);
+}
+
+void GlState::stencilMask(GLuint mask) {
+    if (!changed(mask != stencilWriteMask || !stencilWriteKnown)) return;
+    stencilWriteMask = mask;
+    stencilWriteKnown = true;
+    glStencilMask(mask);
+}
+
+void GlState::stencilOp(GLenum fail, GLenum depthFail, GLenum pass) {
+    if (!changed(fail != stencilOps[0] || depthFail != stencilOps[1] || pass != stencilOps[2])) return;
+    stencilOps[0] = fail;
+    stencilOps[1] = depthFail;
+    stencilOps[2] = pass;
+    glStencilOp(fail, depthFail, pass);
+}
+
+void GlState::clearColor(float r, float g, float b, float a) {
+    if (!changed(r != clearRgba[0] || g != clearRgba[1] || b != clearRgba[2] || a != clearRgba[3])) return;
+    clearRgba[0] = r;
+    clearRgba[1] = g;
+    clearRgba[2] = b;
+    clearRgba[3] = a;
+    glClearColor(r, g, b, a);
+}
+
+void GlState::viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    if (!changed(x != view[0] || y != view[1] || width != view[2] || height != view[3])) return;
+    view[0] = x;
+    view[1] = y;
+    view[2] = width;
+    view[3] = height;
+    glViewport(x, y, width, height);
+}
+
+void GlState::clear(GLbitfield mask) {
+    flush();
+    glClear(mask);
+    GL_STAT(frame.drawCalls++);
+}
+
+void GlState::readPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, void* pixels) {
+    flush();
+    glReadPixels(x, y, width, height, format, GL_UNSIGNED_BYTE, pixels);
+    GL_STAT(frame.bytesRead += width * height * (format == GL_RGB ? 3 : format == GL_RGBA ? 4 : 1));
+}
+
+DrawStats GlState::endFrame() {
+    flush();
+    DrawStats done = frame;
+    frame = DrawStats();
+    return done;
+}
@@ -0,0 +1,67 @@
+#include "gputimer.h"
+#include "glfuncs.h"
+#include "glstate.h"
+
+namespace {
+
+const uint64_t MAX_ELAPSED_NS = 1000000000; // Anything longer is a driver glitch (llvmpipe's first query)
+
+} // namespace
+
+GpuTimer::GpuTimer() : enabled(false), frames(), current(0), open(-1), dropped(0) {}
+
+bool GpuTimer::init() {
+    if (!glFuncs.timerQueries()) return false;
+    for (auto& frame : frames) glFuncs.genQueries(QUERIES_PER_FRAME, frame.queries); // Freed with the context
+    enabled = true;
+    return true;
+}
+
+void GpuTimer::beginFrame(Profiler& profiler) {
+    if (!enabled) return;
+    end();
+    frames[current].pending = frames[current].count > 0;
+
+    // Oldest first; queries finish in order, so the first unfinished frame ends the scan
+    for (int k = 1; k <= FRAMES_IN_FLIGHT; ++k) {
+        Frame& frame = frames[(current + k) % FRAMES_IN_FLIGHT];
+        if (!frame.pending) continue;
+        GLuint available = 0;
+        glFuncs.getQueryObjectuiv(frame.queries[frame.count - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) break;
+        uint64_t ns[GPU_ZONE_COUNT] = {};
+        bool valid = true;
+        for (int i = 0; i < frame.count; ++i) {
+            uint64_t elapsed = 0;
+            glFuncs.getQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &elapsed);
+            valid = valid && elapsed <= MAX_ELAPSED_NS;
+            ns[frame.zones[i]] += elapsed;
+        }
+        if (valid) profiler.addGpuFrame(ns);
+        else dropped++;
+        frame.pending = false;
+    }
+
+    current = (current + 1) % FRAMES_IN_FLIGHT;
+    if (frames[current].pending) dropped++; // Reading it now would wait on the GPU
+    frames[current].pending = false;
+    frames[current].count = 0;
+}
+
+void GpuTimer::begin(GpuZone zone) {
+    if (!enabled || open == zone) return;
+    end();
+    Frame& frame = frames[current];
+    if (frame.count == QUERIES_PER_FRAME) return; // Untimed for the rest of the frame
+    frame.zones[frame.count] = static_cast<uint8_t>(zone);
+    glState.flush(); // Not allowed inside glBegin/glEnd
+    glFuncs.beginQuery(GL_TIME_ELAPSED, frame.queries[frame.count++]);
+    open = zone;
+}
+
+void GpuTimer::end() {
+    if (open < 0) return;
+    glState.flush();
+    glFuncs.endQuery(GL_TIME_ELAPSED);
+    open = -1;
+}
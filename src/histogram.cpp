@@ -0,0 +1,56 @@
+#include "histogram.h"
+#include <algorithm>
+
+namespace {
+
+const int BUCKET_COUNT = Histogram::SUB_BUCKETS * (64 - Histogram::SUB_BUCKET_BITS + 1);
+
+int highestBit(uint64_t v) {
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(v);
+#else
+    int bit = 0;
+    while (v >>= 1) bit++;
+    return bit;
+#endif
+}
+
+} // namespace
+
+Histogram::Histogram() : counts(BUCKET_COUNT, 0), total(0), maxValue(0) {}
+
+int Histogram::bucketIndex(uint64_t us) {
+    if (us < static_cast<uint64_t>(SUB_BUCKETS)) return static_cast<int>(us);
+    int shift = highestBit(us) - SUB_BUCKET_BITS;
+    return SUB_BUCKETS * (shift + 1) + static_cast<int>((us >> shift) - SUB_BUCKETS);
+}
+
+uint64_t Histogram::bucketUpperBound(int index) {
+    if (index < SUB_BUCKETS) return index;
+    int shift = index / SUB_BUCKETS - 1;
+    uint64_t low = static_cast<uint64_t>(index % SUB_BUCKETS + SUB_BUCKETS) << shift;
+    return low + (1ull << shift) - 1;
+}
+
+void Histogram::record(uint64_t us) {
+    counts[bucketIndex(us)]++;
+    total++;
+    maxValue = std::max(maxValue, us);
+}
+
+void Histogram::clear() {
+    std::fill(counts.begin(), counts.end(), 0);
+    total = 0;
+    maxValue = 0;
+}
+
+uint64_t Histogram::percentile(double p) const {
+    if (total == 0) return 0;
+    uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(p / 100.0 * total + 0.5));
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        seen += counts[i];
+        if (seen >= target) return std::min(bucketUpperBound(i), maxValue);
+    }
+    return maxValue;
+}
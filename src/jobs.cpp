@@ -0,0 +1,213 @@
+#include "jobs.h"
+#include "affinity.h"
+#include <algorithm>
+#include <chrono>
+
+#ifndef LINES_NO_THREADS
+namespace {
+
+// Which JobSystem worker the current thread is, so submissions go to its own deque
+LINES_THREAD_LOCAL const void* currentSystem = nullptr;
+LINES_THREAD_LOCAL size_t currentWorker = 0;
+
+} // namespace
+#endif
+
+TaskGraph::Task TaskGraph::add(std::function<void()> fn, bool pinned) {
+    nodes.push_back(Node{std::move(fn), {}, 0, pinned});
+    return static_cast<Task>(nodes.size() - 1);
+}
+
+void TaskGraph::depend(Task task, Task on) {
+    nodes[on].successors.push_back(task);
+    nodes[task].dependencies++;
+}
+
+JobSystem::JobSystem(int threads) : stopping(false), queued(0) {
+#ifdef LINES_NO_THREADS
+    threads = 1;
+#else
+    if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+#endif
+    for (int i = 0; i < threads; ++i) queues.emplace_back(new Queue());
+#ifndef LINES_NO_THREADS
+    for (int i = 1; i < threads; ++i) workers.emplace_back(&JobSystem::workerLoop, this, static_cast<size_t>(i));
+#endif
+}
+
+JobSystem::~JobSystem() {
+    stopping = true;
+#ifndef LINES_NO_THREADS
+    wake.notify_all();
+    for (auto& worker : workers) worker.join();
+#endif
+}
+
+void JobSystem::start(TaskGraph& graph) {
+    size_t count = graph.nodes.size();
+    if (graph.pendingCapacity < count) {
+        graph.pending.reset(new std::atomic<int>[count]);
+        graph.pendingCapacity = count;
+    }
+    for (size_t i = 0; i < count; ++i) graph.pending[i].store(graph.nodes[i].dependencies, std::memory_order_relaxed);
+    graph.pinnedReady.clear();
+    graph.remaining.store(static_cast<int>(count), std::memory_order_release);
+}
+
+void JobSystem::runSerial(TaskGraph& graph) {
+    start(graph);
+    // Ready tasks run in FIFO order, so a serial run is deterministic
+    std::vector<TaskGraph::Task> ready;
+    ready.reserve(graph.nodes.size());
+    for (size_t i = 0; i < graph.nodes.size(); ++i) {
+        if (graph.nodes[i].dependencies == 0) ready.push_back(static_cast<TaskGraph::Task>(i));
+    }
+    for (size_t k = 0; k < ready.size(); ++k) {
+        const TaskGraph::Node& node = graph.nodes[ready[k]];
+        node.fn();
+        for (TaskGraph::Task next : node.successors) {
+            if (graph.pending[next].fetch_sub(1, std::memory_order_relaxed) == 1) ready.push_back(next);
+        }
+    }
+    graph.remaining.store(0, std::memory_order_relaxed);
+}
+
+void JobSystem::run(TaskGraph& graph) {
+#ifdef LINES_NO_THREADS
+    runSerial(graph);
+#else
+    if (queues.size() == 1 || graph.nodes.empty()) {
+        runSerial(graph);
+        return;
+    }
+    start(graph);
+    for (size_t i = 0; i < graph.nodes.size(); ++i) {
+        if (graph.nodes[i].dependencies == 0) submit(graph, static_cast<TaskGraph::Task>(i));
+    }
+    size_t self = currentSystem == this ? currentWorker : 0;
+    while (graph.remaining.load(std::memory_order_acquire) > 0) {
+        Job job{&graph, -1};
+        {
+            std::lock_guard<std::mutex> lock(graph.pinnedMutex);
+            if (!graph.pinnedReady.empty()) {
+                job.task = graph.pinnedReady.front();
+                graph.pinnedReady.pop_front();
+            }
+        }
+        if (job.task >= 0 || takeJob(self, job)) {
+            execute(job);
+            continue;
+        }
+        // Nothing to run here yet: sleep like a worker rather than spin, which would
+        // starve the workers if this thread is SCHED_FIFO on a CPU they share.
+        // Finishing the graph and readying a pinned task notify under sleepMutex.
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait_for(lock, std::chrono::milliseconds(1), [this, &graph] {
+            if (graph.remaining.load(std::memory_order_acquire) == 0 || queued.load(std::memory_order_relaxed) > 0) return true;
+            std::lock_guard<std::mutex> pinnedLock(graph.pinnedMutex);
+            return !graph.pinnedReady.empty();
+        });
+    }
+#endif
+}
+
+void JobSystem::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn) {
+    if (count == 0) return;
+    size_t chunks = std::min(count / std::max<size_t>(grain, 1), queues.size() * 4);
+    if (chunks <= 1) {
+        fn(0, count);
+        return;
+    }
+    TaskGraph graph;
+    for (size_t c = 0; c < chunks; ++c) {
+        size_t begin = count * c / chunks, end = count * (c + 1) / chunks;
+        graph.add([&fn, begin, end] { fn(begin, end); });
+    }
+    run(graph);
+}
+
+void JobSystem::submit(TaskGraph& graph, TaskGraph::Task task) {
+#ifdef LINES_NO_THREADS
+    (void)graph;
+    (void)task;
+#else
+    if (graph.nodes[task].pinned) {
+        {
+            std::lock_guard<std::mutex> lock(graph.pinnedMutex);
+            graph.pinnedReady.push_back(task);
+        }
+        std::lock_guard<std::mutex> lock(sleepMutex); // The run() caller may be between its check and its wait
+        wake.notify_all();
+        return;
+    }
+    Queue& queue = *queues[currentSystem == this ? currentWorker : 0];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(Job{&graph, task});
+    }
+    queued.fetch_add(1, std::memory_order_release);
+    wake.notify_one();
+#endif
+}
+
+bool JobSystem::takeJob(size_t self, Job& job) {
+#ifndef LINES_NO_THREADS
+    if (queued.load(std::memory_order_acquire) == 0) return false;
+    size_t count = queues.size();
+    for (size_t k = 0; k < count; ++k) {
+        Queue& queue = *queues[(self + k) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty()) continue;
+        if (k == 0) { // Own deque: newest first, it is likely still in cache
+            job = queue.jobs.back();
+            queue.jobs.pop_back();
+        } else { // Steal the oldest
+            job = queue.jobs.front();
+            queue.jobs.pop_front();
+        }
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+#else
+    (void)self;
+    (void)job;
+#endif
+    return false;
+}
+
+void JobSystem::execute(const Job& job) {
+    TaskGraph& graph = *job.graph;
+    const TaskGraph::Node& node = graph.nodes[job.task];
+    node.fn();
+    for (TaskGraph::Task next : node.successors) {
+        if (graph.pending[next].fetch_sub(1, std::memory_order_acq_rel) == 1) submit(graph, next);
+    }
+    if (graph.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) { // Last touch of the graph
+#ifndef LINES_NO_THREADS
+        std::lock_guard<std::mutex> lock(sleepMutex); // Wake the run() caller
+        wake.notify_all();
+#endif
+    }
+}
+
+void JobSystem::workerLoop(size_t index) {
+#ifndef LINES_NO_THREADS
+    currentSystem = this;
+    currentWorker = index;
+    applyThreadRole(THREAD_WORKER, static_cast<int>(index) - 1);
+    while (!stopping.load(std::memory_order_acquire)) {
+        Job job;
+        if (takeJob(index, job)) {
+            execute(job);
+            continue;
+        }
+        // Timed wait: a submit racing with this check costs at most a millisecond
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait_for(lock, std::chrono::milliseconds(1), [this] {
+            return stopping.load(std::memory_order_relaxed) || queued.load(std::memory_order_relaxed) > 0;
+        });
+    }
+#else
+    (void)index;
+#endif
+}
@@ -4,176 +4,136 @@
 #include <cmath>
 #include <random>
 #include <string>
+#include <memory>
 #include <chrono>
-#include <map>
 #include <algorithm>
-
-const int WIDTH = 1920, HEIGHT = 1080;
-const float PLAYER_SPEED = 200.0f; // Pixels per second
-const float CIRCLE_SPEED = 300.0f; // Pixels per second
-const float TURN_SPEED = 2.0f * M_PI; // Radians per second
-const int PLAYER_SIZE = 4; // Player pixel size (quad)
-const int TRAIL_SIZE = 2; // Trail pixel size (quad)
-const int CIRCLE_RADIUS = 45; // Enemy circle radius
-const float COLLECTIBLE_SIZE = CIRCLE_RADIUS * 2; // Green square size
-const float BLACK_CIRCLE_SIZE = COLLECTIBLE_SIZE; // Black circle radius (2x green square size)
-const float BLACK_SQUARE_SIZE = COLLECTIBLE_SIZE * 5; // 5x larger black square
-const int COLLISION_CHECK_SIZE = 5; // Size of square area to check for collisions (pixels)
-
-struct Vec2 {
-    float x, y;
-    Vec2(float x = 0, float y = 0) : x(x), y(y) {}
-    Vec2 operator+(const Vec2& other) const { return Vec2(x + other.x, y + other.y); }
-    Vec2 operator*(float s) const { return Vec2(x * s, y * s); }
-};
-
-struct Player {
-    Vec2 pos;
-    Vec2 direction;
-    SDL_Color color;
-    std::vector<Vec2> trail;
-    bool alive;
-    bool willDie; // Flag for next-frame death
-    bool hasMoved; // Flag for invincibility
-};
-
-struct Circle {
-    Vec2 pos;
-    Vec2 vel;
-    float radius;
-};
-
-struct Collectible {
-    Vec2 pos;
-    float size; // Green square size
-    float blackCircleSize; // Black circle radius
-    float blackSquareSize; // Black square size
-};
-
-const std::map<char, std::vector<bool>> FONT = {
-    {'0', {1,1,1,1,1, 1,0,0,0,1, 1,0,0,0,1, 1,0,0,0,1, 1,1,1,1,1}},
-    {'1', {0,0,1,0,0, 0,0,1,0,0, 0,0,1,0,0, 0,0,1,0,0, 0,0,1,0,0}},
-    {'2', {1,1,1,1,1, 0,0,0,0,1, 1,1,1,1,1, 1,0,0,0,0, 1,1,1,1,1}},
-    {'3', {1,1,1,1,1, 0,0,0,0,1, 1,1,1,1,1, 0,0,0,0,1, 1,1,1,1,1}},
-    {'4', {1,0,0,0,1, 1,0,0,0,1, 1,1,1,1,1, 0,0,0,0,1, 0,0,0,0,1}},
-    {'5', {1,1,1,1,1, 1,0,0,0,0, 1,1,1,1,1, 0,0,0,0,1, 1,1,1,1,1}},
-    {'6', {1,1,1,1,1, 1,0,0,0,0, 1,1,1,1,1, 1,0,0,0,1, 1,1,1,1,1}},
-    {'7', {1,1,1,1,1, 0,0,0,0,1, 0,0,0,0,1, 0,0,0,0,1, 0,0,0,0,1}},
-    {'8', {1,1,1,1,1, 1,0,0,0,1, 1,1,1,1,1, 1,0,0,0,1, 1,1,1,1,1}},
-    {'9', {1,1,1,1,1, 1,0,0,0,1, 1,1,1,1,1, 0,0,0,0,1, 1,1,1,1,1}},
-    {'-', {0,0,0,0,0, 0,0,0,0,0, 1,1,1,1,1, 0,0,0,0,0, 0,0,0,0,0}},
-    {' ', {0,0,0,0,0, 0,0,0,0,0, 0,0,0,0,0, 0,0,0,0,0, 0,0,0,0,0}}
-};
-
-void drawSquare(float x, float y, float size, const SDL_Color& color) {
-    glColor3ub(color.r, color.g, color.b);
-    glBegin(GL_QUADS);
-    glVertex2f(x, y);
-    glVertex2f(x + size, y);
-    glVertex2f(x + size, y + size);
-    glVertex2f(x, y + size);
-    glEnd();
+#include <cstdio>
+#include <cstdlib>
+#include "game.h"
+#include "jobs.h"
+#include "affinity.h"
+#include "pipeline.h"
+#include "render.h"
+#include "glcollision.h"
+#include "glfuncs.h"
+#include "gputimer.h"
+#include "glstate.h"
+#include "softraster.h"
+#include "capture.h"
+#include "checkpoint.h"
+#include "bench.h"
+#include "config.h"
+#include "dataset.h"
+#include "replay.h"
+#include "sweep.h"
+#include "profiler.h"
+#include "telemetry.h"
+#include <csignal>
+#include <atomic>
+#ifndef LINES_NO_THREADS
+#include <thread>
+#endif
+
+const int REWIND_TICKS_PER_SECOND = 60; // --rewind sizes the ring in ticks at this rate
+const int SCRUB_TICKS_PER_FRAME = 2; // Holding a scrub key plays back (or forward) at double speed
+
+// Set from SIGUSR1 so ops can ask a running cabinet for its frame time report
+std::atomic<bool> dumpRequested(false);
+
+void requestDump(int) {
+    dumpRequested = true;
 }
 
-void drawCircle(float x, float y, float radius, const SDL_Color& color) {
-    glColor3ub(color.r, color.g, color.b);
-    glBegin(GL_TRIANGLE_FAN);
-    for (int i = 0; i < 360; i++) {
-        float rad = i * M_PI / 180.0f;
-        glVertex2f(x + cos(rad) * radius, y + sin(rad) * radius);
+// The --collision name that records a replay's header backend
+const char* collisionModeName(ReplayCollision collision) {
+    switch (collision) {
+    case REPLAY_COLLISION_CPU: return "cpu";
+    case REPLAY_COLLISION_READBACK: return "readback";
+    case REPLAY_COLLISION_IDS: return "ids";
+    case REPLAY_COLLISION_OCCLUSION: return "gl";
+    default: return "";
     }
-    glEnd();
 }
 
-void drawText(const std::string& text, float x, float y, float squareSize, const SDL_Color& color) {
-    glColor3ub(color.r, color.g, color.b);
-    float charWidth = squareSize * 6;
-    for (size_t i = 0; i < text.size(); ++i) {
-        char c = text[i];
-        if (FONT.find(c) == FONT.end()) continue;
-        const auto& pattern = FONT.at(c);
-        float startX = x + i * charWidth;
-        for (int row = 0; row < 5; ++row) {
-            for (int col = 0; col < 5; ++col) {
-                if (pattern[row * 5 + col]) {
-                    drawSquare(startX + col * squareSize, y + row * squareSize, squareSize, color);
-                }
-            }
+int main(int argc, char* argv[]) {
+    // Command line: --config <file>, --record <file>, --replay <file>, --collision gl|ids|readback|cpu,
+    // --sweep <spec> [--out <file>] [--threads <n>], --bench <name> [--threads <n>],
+    // --telemetry <file|unix:path>, --stutter-ms <ms>, --affinity <role=cpus>, --priority <role=fifo:N|nice:N>,
+    // --renderer gl|soft, --screenshot <file.ppm> --replay <file> [--capture-every <frames>], --run-ahead <ticks>,
+    // --rewind <seconds>, --checkpoint <file>, --export <replay list> [--out <file>] [--threads <n>]
+    std::string collisionMode = "gl", configPath = DEFAULT_CONFIG_PATH, recordPath, replayPath, sweepPath, outPath, exportList, telemetryTarget, benchName, screenshotPath,
+                checkpointPath;
+    bool softRender = false, collisionGiven = false;
+    int captureEvery = 0;
+    int runAhead = 0;
+    int rewindSeconds = 10;
+    float stutterMs = 50.0f;
+    int threads = 1;
+#ifndef LINES_NO_THREADS
+    threads = std::max(1u, std::thread::hardware_concurrency());
+#endif
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--config") configPath = argv[i + 1];
+        else if (arg == "--record") recordPath = argv[i + 1];
+        else if (arg == "--replay") replayPath = argv[i + 1];
+        else if (arg == "--collision") {
+            collisionMode = argv[i + 1];
+            collisionGiven = true;
         }
+        else if (arg == "--renderer") softRender = std::string(argv[i + 1]) == "soft";
+        else if (arg == "--screenshot") screenshotPath = argv[i + 1];
+        else if (arg == "--capture-every") captureEvery = std::atoi(argv[i + 1]);
+        else if (arg == "--sweep") sweepPath = argv[i + 1];
+        else if (arg == "--bench") benchName = argv[i + 1];
+        else if (arg == "--out") outPath = argv[i + 1];
+        else if (arg == "--export") exportList = argv[i + 1];
+        else if (arg == "--telemetry") telemetryTarget = argv[i + 1];
+        else if (arg == "--stutter-ms") stutterMs = std::atof(argv[i + 1]);
+        else if (arg == "--run-ahead") runAhead = std::max(0, std::min(std::atoi(argv[i + 1]), static_cast<int>(SimStage::MAX_RUN_AHEAD)));
+        else if (arg == "--checkpoint") checkpointPath = argv[i + 1];
+        else if (arg == "--rewind") rewindSeconds = std::max(0, std::atoi(argv[i + 1]));
+        else if (arg == "--threads") threads = std::max(1, std::atoi(argv[i + 1]));
+        else if (arg == "--affinity" && !parseAffinity(argv[i + 1])) std::fprintf(stderr, "Bad --affinity %s\n", argv[i + 1]);
+        else if (arg == "--priority" && !parsePriority(argv[i + 1])) std::fprintf(stderr, "Bad --priority %s\n", argv[i + 1]);
     }
-}
-
-void drawPlayer(const Player& player) {
-    drawSquare(player.pos.x - PLAYER_SIZE / 2, player.pos.y - PLAYER_SIZE / 2, PLAYER_SIZE, player.color);
-}
-
-void drawTrail(const Player& player, int skipRecent = 0) {
-    glColor3ub(player.color.r, player.color.g, player.color.b);
-    glBegin(GL_QUADS);
-    size_t start = std::max<size_t>(0, player.trail.size() - skipRecent);
-    for (size_t i = 0; i < start; ++i) {
-        const auto& p = player.trail[i];
-        float halfSize = TRAIL_SIZE / 2.0f;
-        glVertex2f(p.x - halfSize, p.y - halfSize);
-        glVertex2f(p.x + halfSize, p.y - halfSize);
-        glVertex2f(p.x + halfSize, p.y + halfSize);
-        glVertex2f(p.x - halfSize, p.y + halfSize);
-    }
-    glEnd();
-}
-
-void drawCollectibleBlackSquare(const Collectible& collectible) {
-    drawSquare(collectible.pos.x - collectible.blackSquareSize / 2, collectible.pos.y - collectible.blackSquareSize / 2, collectible.blackSquareSize, {0, 0, 0, 255});
-}
-
-void drawCollectibleBlackCircle(const Collectible& collectible) {
-    drawCircle(collectible.pos.x, collectible.pos.y, collectible.blackCircleSize, {0, 0, 0, 255});
-}
-
-void drawCollectibleGreenSquare(const Collectible& collectible) {
-    drawSquare(collectible.pos.x - collectible.size / 2, collectible.pos.y - collectible.size / 2, collectible.size, {0, 255, 0, 255});
-}
-
-bool checkPixelCollision(const Vec2& pos) {
-    GLubyte pixel[3];
-    glReadPixels((int)pos.x, HEIGHT - (int)pos.y, 1, 1, GL_RGB, GL_UNSIGNED_BYTE, pixel);
-    return !(pixel[0] == 0 && pixel[1] == 0 && pixel[2] == 0); // Not black
-}
-
-bool checkAreaCollision(const Vec2& center, int size) {
-    int halfSize = size / 2;
-    for (int dx = -halfSize; dx <= halfSize; dx++) {
-        for (int dy = -halfSize; dy <= halfSize; dy++) {
-            Vec2 checkPos(center.x + dx, center.y + dy);
-            if (checkPos.x < 0 || checkPos.x >= WIDTH || checkPos.y < 0 || checkPos.y >= HEIGHT) continue;
-            if (checkPixelCollision(checkPos)) return true;
+    if (!sweepPath.empty()) return runSweep(sweepPath, outPath.empty() ? "sweep.tsv" : outPath, threads); // Headless, no window
+    if (!exportList.empty()) return runExport(exportList, outPath.empty() ? "dataset.lnds" : outPath, threads);
+    if (!benchName.empty()) return runBench(benchName, threads);
+    if (!screenshotPath.empty()) return runScreenshot(replayPath, screenshotPath, captureEvery, threads);
+
+    GameConfig config;
+    ReplayReader replay;
+    if (!replayPath.empty()) {
+        if (!replay.open(replayPath)) {
+            std::fprintf(stderr, "Cannot read replay %s\n", replayPath.c_str());
+            return 1;
         }
+        config = replay.headerConfig();
+    } else {
+        loadConfig(configPath, config);
     }
-    return false;
-}
+    ConfigWatcher configWatcher(configPath);
+    Telemetry telemetry;
+    if (!telemetryTarget.empty()) telemetry.open(telemetryTarget);
 
-bool checkCollectibleCollision(const Vec2& playerPos, const Collectible& collectible) {
-    float halfSize = collectible.size / 2;
-    return playerPos.x >= collectible.pos.x - halfSize &&
-           playerPos.x <= collectible.pos.x + halfSize &&
-           playerPos.y >= collectible.pos.y - halfSize &&
-           playerPos.y <= collectible.pos.y + halfSize;
-}
-
-Collectible spawnCollectible(std::mt19937& rng) {
-    // Use black square size for spawn boundaries to ensure it fits
-    std::uniform_real_distribution<float> distX(BLACK_SQUARE_SIZE / 2, WIDTH - BLACK_SQUARE_SIZE / 2);
-    std::uniform_real_distribution<float> distY(BLACK_SQUARE_SIZE / 2, HEIGHT - BLACK_SQUARE_SIZE / 2);
-    return Collectible{Vec2(distX(rng), distY(rng)), COLLECTIBLE_SIZE, BLACK_CIRCLE_SIZE, BLACK_SQUARE_SIZE};
-}
-
-int main(int argc, char* argv[]) {
     SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER);
-    SDL_Window* window = SDL_CreateWindow("2 Player Lines Game", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, WIDTH, HEIGHT, SDL_WINDOW_OPENGL);
-    SDL_GLContext glContext = SDL_GL_CreateContext(window);
-    SDL_GL_SetSwapInterval(1); // Enable VSync
-    glOrtho(0, WIDTH, HEIGHT, 0, -1, 1);
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    if (!softRender) SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8); // Occlusion collision marks trails in the stencil
+    SDL_Window* window = SDL_CreateWindow("2 Player Lines Game", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, WIDTH, HEIGHT, softRender ? 0 : SDL_WINDOW_OPENGL);
+    SDL_GLContext glContext = nullptr;
+    SDL_Renderer* softPresenter = nullptr; // --renderer soft: the framebuffer goes up as a streaming texture (SDL2 only)
+    SDL_Texture* softTexture = nullptr;
+    if (softRender) {
+        softPresenter = SDL_CreateRenderer(window, -1, SDL_RENDERER_PRESENTVSYNC);
+        softTexture = SDL_CreateTexture(softPresenter, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, WIDTH, HEIGHT);
+    } else {
+        glContext = SDL_GL_CreateContext(window);
+        loadGlFunctions();
+        SDL_GL_SetSwapInterval(1); // Enable VSync
+        glOrtho(0, WIDTH, HEIGHT, 0, -1, 1);
+        glState.clearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+    SoftRenderer softRenderer;
 
     // Controller setup
     SDL_GameController* controllers[2] = {nullptr, nullptr};
@@ -187,37 +147,80 @@ int main(int argc, char* argv[]) {
 
     // Game state
     std::random_device rd;
-    std::mt19937 rng(rd());
-    std::uniform_real_distribution<float> distX(50, WIDTH - 50);
-    std::uniform_real_distribution<float> distY(50, HEIGHT - 50);
-
-    Player player1, player2;
-    player1.pos = Vec2(200, HEIGHT / 2);
-    player1.direction = Vec2(1, 0);
-    player1.color = {0, 0, 255, 255}; // Blue
-    player1.alive = true;
-    player1.willDie = false;
-    player1.hasMoved = false;
-
-    player2.pos = Vec2(WIDTH - 200, HEIGHT / 2);
-    player2.direction = Vec2(-1, 0);
-    player2.color = {255, 0, 0, 255}; // Red
-    player2.alive = true;
-    player2.willDie = false;
-    player2.hasMoved = false;
-
-    std::vector<Circle> circles;
-    float angle = std::uniform_real_distribution<float>(0, 2 * M_PI)(rng);
-    circles.push_back(Circle{Vec2(distX(rng), distY(rng)), Vec2(CIRCLE_SPEED * cos(angle), CIRCLE_SPEED * sin(angle)), CIRCLE_RADIUS});
-
-    Collectible collectible = spawnCollectible(rng);
-
-    int score1 = 0, score2 = 0;
-    bool gameOver = false;
-    bool gameOverScreen = false; // Flag for score-only screen
+    uint32_t seed = replay.isOpen() ? replay.seedValue() : rd();
+    GameState simState;
+    // --checkpoint: pick up a match a crash cut short, and keep saving this one.
+    // A replay plays its own match, so checkpoints are off then; a recording of
+    // a picked-up match starts from a snapshot of it.
+    std::unique_ptr<CheckpointWriter> checkpoints;
+    bool resumed = false;
+    if (!checkpointPath.empty() && replay.isOpen()) {
+        std::fprintf(stderr, "Checkpoints are off while replaying\n");
+    } else if (!checkpointPath.empty()) {
+        resumed = loadCheckpoint(checkpointPath, simState);
+        if (resumed) std::fprintf(stderr, "Resuming the match saved in %s\n", checkpointPath.c_str());
+        checkpoints.reset(new CheckpointWriter(checkpointPath));
+    }
+    if (replay.isOpen()) replay.startMatch(simState);
+    else if (!resumed) newGame(simState, config, seed);
+    ReadbackCollision readbackCollision;
+    OcclusionCollision occlusionCollision;
+    IdBufferCollision idCollision;
+    CpuCollision cpuCollision;
+    LateCollision lateCollision(cpuCollision);
+    // A replay plays with the backend named in its header, on the CPU so GL
+    // drivers cannot change its hits (as capture.cpp); replays older than
+    // that header keep --collision.
+    CollisionBackend* playback = replay.isOpen() ? playbackCollision(replay, cpuCollision, lateCollision) : nullptr;
+    CollisionBackend* collisionBackend = &readbackCollision;
+    if (playback) {
+        collisionBackend = playback;
+        const char* recorded = collisionModeName(replay.collisionUsed());
+        if (collisionGiven && collisionMode != recorded) {
+            std::fprintf(stderr, "Replay %s was recorded with --collision %s, ignoring --collision %s\n", replayPath.c_str(), recorded,
+                         collisionMode.c_str());
+        }
+    } else if (collisionMode == "cpu" || softRender) { // The GPU tests need GL
+        collisionBackend = &cpuCollision;
+    } else if (collisionMode == "gl") {
+        if (occlusionCollision.init()) collisionBackend = &occlusionCollision;
+        else std::fprintf(stderr, "No occlusion queries or stencil buffer, collision falls back to pixel readback\n");
+    } else if (collisionMode == "ids") {
+        if (idCollision.init()) collisionBackend = &idCollision;
+        else std::fprintf(stderr, "No framebuffer objects, collision falls back to pixel readback\n");
+    }
+    CollisionBackend& collision = *collisionBackend;
+    ReplayCollision recordedCollision = playback ? replay.collisionUsed() // Same hit timing as the replay's
+                                        : collisionBackend == &cpuCollision ? REPLAY_COLLISION_CPU
+                                        : collisionBackend == &occlusionCollision ? REPLAY_COLLISION_OCCLUSION
+                                        : collisionBackend == &idCollision ? REPLAY_COLLISION_IDS : REPLAY_COLLISION_READBACK; // After any fallback
+    ReplayWriter recorder;
+    if (!recordPath.empty() && !recorder.open(recordPath, seed, config, recordedCollision, resumed ? &simState : nullptr)) {
+        std::fprintf(stderr, "Cannot write replay %s\n", recordPath.c_str());
+    }
     bool firstFrame = true; // Flag to show score on first frame
-    auto lastCircleSpawn = std::chrono::steady_clock::now();
-    auto gameOverTime = lastCircleSpawn;
+    RenderList frameList; // Recorded on this thread when the sim runs inline
+    JobSystem jobs(threads); // Tick task graph workers (--threads, default all cores)
+    SimStage sim(simState, config, collision, jobs, telemetry, collision.concurrent() && threads > 1, runAhead,
+                 rewindSeconds * REWIND_TICKS_PER_SECOND, checkpoints.get()); // Owns simState from here
+    applyThreadRole(THREAD_MAIN); // After the other threads exist, so they do not inherit it
+
+    // Frame/tick histograms and stutter snapshots; F2 or SIGUSR1 prints them, F3 shows the overlay
+    Profiler profiler(stutterMs);
+    bool showOverlay = false;
+    GpuTimer gpuTimer; // Render stage GPU times, where the driver has timer queries
+    if (!softRender) gpuTimer.init();
+    bool timeCollision = !collision.concurrent(); // GL collision runs inline on this thread
+    const int HISTOGRAM_REPORT_FRAMES = 300; // Percentiles to telemetry every ~5s at 60fps
+    int framesSinceReport = 0;
+    // Rewind (F5 or Back): the sim pauses and left/right scrub through the ring; Enter or A plays on from there
+    int scrubBack = -1; // Ticks back being shown, -1 when live
+    int scrubHeld = 0; // +1 scrubbing back, -1 forward
+    bool scrubResume = false;
+    bool canResume = !replay.isOpen() && !recorder.isOpen(); // A replay cannot express the jump
+#ifdef SIGUSR1
+    std::signal(SIGUSR1, requestDump);
+#endif
 
     // Game loop
     bool running = true;
@@ -226,11 +229,26 @@ int main(int argc, char* argv[]) {
         auto currentTime = std::chrono::steady_clock::now();
         float dt = std::chrono::duration<float>(currentTime - lastTime).count();
         lastTime = currentTime;
+        profiler.beginFrame();
+        gpuTimer.beginFrame(profiler);
 
         // Handle input
+        profiler.begin(ZONE_INPUT);
         SDL_Event event;
         while (SDL_PollEvent(&event)) {
             if (event.type == SDL_QUIT) running = false;
+            if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F2) dumpRequested = true;
+            if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F3) showOverlay = !showOverlay;
+            bool down = event.type == SDL_KEYDOWN || event.type == SDL_CONTROLLERBUTTONDOWN;
+            bool up = event.type == SDL_KEYUP || event.type == SDL_CONTROLLERBUTTONUP;
+            bool key = event.type == SDL_KEYDOWN || event.type == SDL_KEYUP;
+            SDL_Keycode sym = key ? event.key.keysym.sym : 0;
+            int button = key ? -1 : event.cbutton.button;
+            if (down && (sym == SDLK_F5 || button == SDL_CONTROLLER_BUTTON_BACK)) scrubBack = scrubBack < 0 ? 0 : -1;
+            if (down && (sym == SDLK_LEFT || button == SDL_CONTROLLER_BUTTON_DPAD_LEFT)) scrubHeld = 1;
+            if (down && (sym == SDLK_RIGHT || button == SDL_CONTROLLER_BUTTON_DPAD_RIGHT)) scrubHeld = -1;
+            if (up && (sym == SDLK_LEFT || sym == SDLK_RIGHT || button == SDL_CONTROLLER_BUTTON_DPAD_LEFT || button == SDL_CONTROLLER_BUTTON_DPAD_RIGHT)) scrubHeld = 0;
+            if (down && scrubBack >= 0 && (sym == SDLK_RETURN || button == SDL_CONTROLLER_BUTTON_A)) scrubResume = true;
             if (event.type == SDL_CONTROLLERBUTTONDOWN) {
                 if (event.cbutton.button == SDL_CONTROLLER_BUTTON_X || event.cbutton.button == SDL_CONTROLLER_BUTTON_A) {
                     // Toggle pause (not game over screen)
@@ -238,148 +256,99 @@ int main(int argc, char* argv[]) {
             }
         }
 
-        if (!gameOverScreen && !gameOver) {
-            // Controller input for steering
-            for (int i = 0; i < controllerCount; ++i) {
-                if (!controllers[i]) continue;
-                Player& player = (i == 0) ? player1 : player2;
-                if (!player.alive) continue;
-
-                Sint16 leftTrigger = SDL_GameControllerGetAxis(controllers[i], SDL_CONTROLLER_AXIS_TRIGGERLEFT);
-                Sint16 rightTrigger = SDL_GameControllerGetAxis(controllers[i], SDL_CONTROLLER_AXIS_TRIGGERRIGHT);
-                if (leftTrigger > 0 || rightTrigger > 0) player.hasMoved = true; // Mark as moved on trigger press
-                float turn = (rightTrigger - leftTrigger) / 32768.0f * TURN_SPEED * dt;
-                float angle = atan2(player.direction.y, player.direction.x) + turn;
-                player.direction = Vec2(cos(angle), sin(angle));
+        // Tick boundary: pick up config edits (live) or recorded config changes (replay)
+        SimInput input{SIM_FRAME, ReplayFrame{dt, {{0, 0}, {0, 0}}}, config, 0};
+        if (scrubBack >= 0) {
+            // Paused: no frame is read, recorded or stepped while scrubbing
+            scrubBack = std::max(0, scrubBack + scrubHeld * SCRUB_TICKS_PER_FRAME);
+            input.type = SIM_SCRUB;
+            input.ticksBack = scrubBack;
+            if (scrubResume && canResume) {
+                input.type = SIM_REWIND;
+                scrubBack = -1;
+            } else if (scrubResume) {
+                std::fprintf(stderr, "Cannot play on from a rewind while recording or replaying\n");
             }
-
-            // Update players
-            for (auto& player : {&player1, &player2}) {
-                if (!player->alive) continue;
-
-                // Check collision
-                Vec2 nextPos = player->pos + player->direction * PLAYER_SPEED * dt;
-                if (!player->willDie) {
-                    // Check wall collision (always applies)
-                    if (nextPos.x < 0 || nextPos.x > WIDTH || nextPos.y < 0 || nextPos.y > HEIGHT) {
-                        player->willDie = true;
-                    }
-                    // Check trail/circle collision (only if hasMoved)
-                    else if (player->hasMoved) {
-                        glClear(GL_COLOR_BUFFER_BIT);
-                        drawTrail(player1, player == &player1 ? 5 : 0); // Skip last 5 points for self
-                        drawTrail(player2, player == &player2 ? 5 : 0);
-                        for (const auto& circle : circles) drawCircle(circle.pos.x, circle.pos.y, circle.radius, {255, 255, 0, 255});
-                        if (checkAreaCollision(nextPos, COLLISION_CHECK_SIZE)) {
-                            player->willDie = true;
-                        }
-                    }
-                } else {
-                    player->alive = false;
-                    continue;
-                }
-
-                // Move and add trail
-                player->pos = nextPos;
-                player->trail.push_back(player->pos);
-
-                // Check collectible collision (allowed even if invincible)
-                if (checkCollectibleCollision(player->pos, collectible)) {
-                    if (player == &player1) score1++;
-                    else score2++;
-                    collectible = spawnCollectible(rng);
-                }
+            scrubResume = false;
+        } else if (replay.isOpen()) {
+            ReplayRecord record;
+            while ((record = replay.next(input.frame, input.config)) == REPLAY_CONFIG) {
+                config = input.config;
+                sim.submit(SimInput{SIM_CONFIG, input.frame, config, 0});
             }
-
-            // Update circles
-            for (auto& circle : circles) {
-                circle.pos = circle.pos + circle.vel * dt;
-                if (circle.pos.x - circle.radius < 0 || circle.pos.x + circle.radius > WIDTH) {
-                    circle.vel.x = -circle.vel.x;
-                    circle.pos.x = std::max(circle.radius, std::min(WIDTH - circle.radius, circle.pos.x));
-                }
-                if (circle.pos.y - circle.radius < 0 || circle.pos.y + circle.radius > HEIGHT) {
-                    circle.vel.y = -circle.vel.y;
-                    circle.pos.y = std::max(circle.radius, std::min(HEIGHT - circle.radius, circle.pos.y));
-                }
-
-                // Clear trails
-                for (auto& player : {&player1, &player2}) {
-                    player->trail.erase(
-                        std::remove_if(player->trail.begin(), player->trail.end(),
-                            [&](const Vec2& p) {
-                                float dx = circle.pos.x - p.x, dy = circle.pos.y - p.y;
-                                return sqrt(dx * dx + dy * dy) < circle.radius;
-                            }),
-                        player->trail.end());
-                }
-            }
-
-            // Spawn new yellow circle every 5 seconds
-            if (std::chrono::duration<float>(currentTime - lastCircleSpawn).count() > 5.0f) {
-                float angle = std::uniform_real_distribution<float>(0, 2 * M_PI)(rng);
-                circles.push_back(Circle{Vec2(distX(rng), distY(rng)), Vec2(CIRCLE_SPEED * cos(angle), CIRCLE_SPEED * sin(angle)), CIRCLE_RADIUS});
-                lastCircleSpawn = currentTime;
+            if (record == REPLAY_ERROR) std::fprintf(stderr, "Replay %s is damaged, stopping there\n", replayPath.c_str());
+            if (record != REPLAY_FRAME) break;
+        } else {
+            GameConfig next = config;
+            if (configWatcher.poll(next)) {
+                config = next;
+                sim.submit(SimInput{SIM_CONFIG, input.frame, config, 0});
+                recorder.writeConfig(config);
             }
-
-            // Check game over
-            if (!player1.alive || !player2.alive) {
-                gameOver = true;
-                gameOverScreen = true;
-                gameOverTime = currentTime;
-                if (!player1.alive && player2.alive) score2 += 3; // Player1 dies, Player2 gets 3 points
-                else if (!player2.alive && player1.alive) score1 += 3; // Player2 dies, Player1 gets 3 points
-                // No points if both die
+            for (int i = 0; i < controllerCount; ++i) {
+                if (!controllers[i]) continue;
+                input.frame.triggers[i][0] = SDL_GameControllerGetAxis(controllers[i], SDL_CONTROLLER_AXIS_TRIGGERLEFT);
+                input.frame.triggers[i][1] = SDL_GameControllerGetAxis(controllers[i], SDL_CONTROLLER_AXIS_TRIGGERRIGHT);
             }
-        } else if (gameOverScreen && std::chrono::duration<float>(currentTime - gameOverTime).count() > 5.0f) {
-            // Reset game
-            player1 = Player{Vec2(200, HEIGHT / 2), Vec2(1, 0), {0, 0, 255, 255}, {}, true, false, false}; // Blue
-            player2 = Player{Vec2(WIDTH - 200, HEIGHT / 2), Vec2(-1, 0), {255, 0, 0, 255}, {}, true, false, false}; // Red
-            float angle = std::uniform_real_distribution<float>(0, 2 * M_PI)(rng);
-            circles = {Circle{Vec2(distX(rng), distY(rng)), Vec2(CIRCLE_SPEED * cos(angle), CIRCLE_SPEED * sin(angle)), CIRCLE_RADIUS}};
-            collectible = spawnCollectible(rng);
-            gameOver = false;
-            gameOverScreen = false;
-            lastCircleSpawn = currentTime;
+            recorder.writeFrame(input.frame);
         }
-
-        // Render
-        glClear(GL_COLOR_BUFFER_BIT);
-        if (gameOverScreen) {
-            // Show score and countdown during game over
-            std::string scoreText = std::to_string(score1) + "-" + std::to_string(score2);
-            float squareSize = 10.0f;
-            float textWidth = scoreText.size() * squareSize * 6;
-            drawText(scoreText, (WIDTH - textWidth) / 2, HEIGHT / 2 - 25, squareSize, {255, 255, 255, 255});
-            int countdown = 5 - static_cast<int>(std::chrono::duration<float>(currentTime - gameOverTime).count());
-            if (countdown >= 1) {
-                drawText(std::to_string(countdown), (WIDTH - squareSize * 6) / 2, HEIGHT / 2 + 25, squareSize, {255, 255, 255, 255});
-            }
+        sim.submit(input);
+        profiler.end(ZONE_INPUT);
+
+        if (timeCollision) gpuTimer.begin(GPU_ZONE_COLLISION);
+        sim.pump(); // No-op when the sim has its own thread
+        gpuTimer.end();
+        SimFrame simFrame = sim.latest();
+        const GameState& state = *simFrame.state;
+        profiler.add(ZONE_TICK, simFrame.tickUs);
+        profiler.add(ZONE_RUNAHEAD, simFrame.aheadUs);
+
+        // Render: the sim thread has already recorded its snapshot; inline, record it here
+        profiler.begin(ZONE_RENDER);
+        RenderList& list = simFrame.list ? *simFrame.list : frameList;
+        if (!simFrame.list) {
+            list.clear();
+            drawScene(list, state);
+        }
+        if (firstFrame && !state.gameOver) drawScore(list, state); // Flag to show score on first frame
+        firstFrame = false;
+        if (simFrame.scrubTicks >= 0) drawRewind(list, simFrame.scrubTicks, simFrame.rewindTicks);
+        if (scrubBack >= 0 && simFrame.rewindTicks > 0) scrubBack = std::min(scrubBack, simFrame.rewindTicks - 1); // Stop at the oldest tick held
+        if (showOverlay) drawOverlay(list, profiler);
+        if (softRender) {
+            softRenderer.render(list, &jobs);
+            SDL_UpdateTexture(softTexture, nullptr, softRenderer.pixels(), softRenderer.pitch());
+            glState.uploaded(static_cast<size_t>(softRenderer.pitch()) * HEIGHT);
+            SDL_RenderCopy(softPresenter, softTexture, nullptr, nullptr);
         } else {
-            // Normal rendering
-            drawCollectibleBlackSquare(collectible); // Black square
-            drawCollectibleBlackCircle(collectible); // Black circle
-            drawCollectibleGreenSquare(collectible); // Green square
-            for (const auto& circle : circles) drawCircle(circle.pos.x, circle.pos.y, circle.radius, {255, 255, 0, 255}); // Yellow circles
-            drawTrail(player1); // Blue trail
-            drawTrail(player2); // Red trail
-            drawPlayer(player1); // Blue player
-            drawPlayer(player2); // Red player
-            if (firstFrame) {
-                std::string scoreText = std::to_string(score1) + "-" + std::to_string(score2);
-                float squareSize = 10.0f;
-                float textWidth = scoreText.size() * squareSize * 6;
-                drawText(scoreText, (WIDTH - textWidth) / 2, HEIGHT / 2 - 25, squareSize, {255, 255, 255, 255});
-                firstFrame = false;
-            }
+            glState.clear(GL_COLOR_BUFFER_BIT);
+            submitRenderList(list, &gpuTimer);
         }
-        SDL_GL_SwapWindow(window);
+        profiler.end(ZONE_RENDER);
+        profiler.begin(ZONE_SWAP);
+        if (softRender) SDL_RenderPresent(softPresenter);
+        else SDL_GL_SwapWindow(window);
+        profiler.end(ZONE_SWAP);
+
+#ifdef LINES_GL_STATS
+        profiler.setDrawStats(glState.endFrame());
+#endif
+        bool stutter = profiler.endFrame(state);
+        pushFrameTelemetry(telemetry, state, profiler, stutter);
+        if (++framesSinceReport >= HISTOGRAM_REPORT_FRAMES) {
+            pushHistogramTelemetry(telemetry, state, profiler);
+            framesSinceReport = 0;
+        }
+        if (dumpRequested.exchange(false)) profiler.dump(stderr);
     }
 
     // Cleanup
+    if (checkpoints) checkpoints->discard(); // The match ended on purpose; the next start is a new one
     for (auto& controller : controllers) if (controller) SDL_GameControllerClose(controller);
-    SDL_GL_DeleteContext(glContext);
+    if (softTexture) SDL_DestroyTexture(softTexture);
+    if (softPresenter) SDL_DestroyRenderer(softPresenter);
+    if (glContext) SDL_GL_DeleteContext(glContext);
     SDL_DestroyWindow(window);
     SDL_Quit();
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,159 @@
+#include "observe.h"
+#include <algorithm>
+#include <cmath>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+const uint8_t BLOCKED = 255;
+
+// Bilinear blocked fraction (0-255) at level cell coordinates x, y; cells
+// outside the arena are walls
+float sampleLevel(const uint8_t* grid, int width, int height, float x, float y) {
+    int x0 = static_cast<int>(std::floor(x)), y0 = static_cast<int>(std::floor(y));
+    float fx = x - x0, fy = y - y0;
+    float texels[4];
+    for (int i = 0; i < 4; ++i) {
+        int tx = x0 + (i & 1), ty = y0 + (i >> 1);
+        texels[i] = tx >= 0 && tx < width && ty >= 0 && ty < height ? grid[ty * width + tx] : BLOCKED;
+    }
+    float top = texels[0] + (texels[1] - texels[0]) * fx;
+    float bottom = texels[2] + (texels[3] - texels[2]) * fx;
+    return top + (bottom - top) * fy;
+}
+
+inline void store(float* out, float value) {
+    *out = value * (1.0f / 255.0f);
+}
+
+inline void store(uint8_t* out, float value) {
+    *out = static_cast<uint8_t>(value + 0.5f);
+}
+
+// The lattice is affine in row and column, so each step adds a constant
+template <typename Out>
+void sampleHead(const ObservationHead& head, int level, Out* out) {
+    const OccupancyMap& map = *head.map;
+    const uint8_t* grid = map.level(level);
+    int width = map.width(level), height = map.height(level);
+    float cell = static_cast<float>(OCCUPANCY_CELL << level);
+    Vec2 ahead = head.direction, right(-head.direction.y, head.direction.x);
+    // Level cell coordinates of row 0, column 0's center (texel centers sit at +0.5)
+    float half = OBS_GRID / 2 - 0.5f;
+    float originX = head.pos.x / cell - 0.5f + ahead.x * half - right.x * half;
+    float originY = head.pos.y / cell - 0.5f + ahead.y * half - right.y * half;
+    for (int row = 0; row < OBS_GRID; ++row) {
+        float x = originX - ahead.x * row, y = originY - ahead.y * row;
+        float endX = x + right.x * (OBS_GRID - 1), endY = y + right.y * (OBS_GRID - 1);
+        // A row is a straight line, so if both ends have all four texels in
+        // the grid every sample between does, and needs no checks
+        if (std::min(x, endX) >= 0 && std::max(x, endX) < width - 1 && std::min(y, endY) >= 0 && std::max(y, endY) < height - 1) {
+            for (int col = 0; col < OBS_GRID; ++col) {
+                int x0 = static_cast<int>(x), y0 = static_cast<int>(y);
+                float fx = x - x0, fy = y - y0;
+                const uint8_t* texel = grid + y0 * width + x0;
+                float top = texel[0] + (texel[1] - texel[0]) * fx;
+                float bottom = texel[width] + (texel[width + 1] - texel[width]) * fx;
+                store(out++, top + (bottom - top) * fy);
+                x += right.x;
+                y += right.y;
+            }
+            continue;
+        }
+        for (int col = 0; col < OBS_GRID; ++col) {
+            store(out++, sampleLevel(grid, width, height, x, y));
+            x += right.x;
+            y += right.y;
+        }
+    }
+}
+
+template <typename Out>
+void observeAll(const ObservationHead* heads, int count, Out* out, int level) {
+    level = std::max(0, std::min(level, OCCUPANCY_LEVELS - 1));
+    for (int i = 0; i < count; ++i) sampleHead(heads[i], level, out + static_cast<size_t>(i) * OBS_GRID_CELLS);
+}
+
+} // namespace
+
+void boxFilter2x2(const uint8_t* src, int width, int height, uint8_t* dst) {
+    int outWidth = width / 2;
+    for (int y = 0; y < height / 2; ++y) {
+        const uint8_t* a = src + 2 * y * width;
+        const uint8_t* b = a + width;
+        uint8_t* d = dst + y * outWidth;
+        int x = 0;
+#if defined(__SSE2__)
+        // 32 source bytes per row into 16: even and odd bytes widened to 16
+        // bits, the four of each block summed, rounded and narrowed back
+        const __m128i lowBytes = _mm_set1_epi16(0x00ff), two = _mm_set1_epi16(2);
+        for (; x + 16 <= outWidth; x += 16) {
+            __m128i sums[2];
+            for (int half = 0; half < 2; ++half) {
+                __m128i rowA = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + 2 * x + 16 * half));
+                __m128i rowB = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + 2 * x + 16 * half));
+                __m128i sum = _mm_add_epi16(_mm_and_si128(rowA, lowBytes), _mm_srli_epi16(rowA, 8));
+                sum = _mm_add_epi16(sum, _mm_add_epi16(_mm_and_si128(rowB, lowBytes), _mm_srli_epi16(rowB, 8)));
+                sums[half] = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(d + x), _mm_packus_epi16(sums[0], sums[1]));
+        }
+#elif defined(__ARM_NEON)
+        // Pairwise widening adds, then a rounding narrow by 2 bits
+        for (; x + 8 <= outWidth; x += 8) {
+            uint16x8_t sum = vaddq_u16(vpaddlq_u8(vld1q_u8(a + 2 * x)), vpaddlq_u8(vld1q_u8(b + 2 * x)));
+            vst1_u8(d + x, vrshrn_n_u16(sum, 2));
+        }
+#endif
+        for (; x < outWidth; ++x) d[x] = static_cast<uint8_t>((a[2 * x] + a[2 * x + 1] + b[2 * x] + b[2 * x + 1] + 2) >> 2);
+    }
+}
+
+OccupancyMap::OccupancyMap() {
+    for (int i = 0; i < OCCUPANCY_LEVELS; ++i) levels[i].resize(static_cast<size_t>(width(i)) * height(i));
+}
+
+void OccupancyMap::build(const GameState& state) {
+    const int arenaWidth = WIDTH / OCCUPANCY_CELL, arenaHeight = HEIGHT / OCCUPANCY_CELL;
+    const int gridWidth = width(0);
+    uint8_t* grid = levels[0].data();
+    std::fill(grid, grid + arenaHeight * gridWidth, 0);
+    std::fill(grid + arenaHeight * gridWidth, grid + levels[0].size(), BLOCKED); // Padding rows are wall
+    for (int y = 0; y < arenaHeight; ++y) std::fill(grid + y * gridWidth + arenaWidth, grid + (y + 1) * gridWidth, BLOCKED);
+
+    // Points are laid under TRAIL_SPACING apart, less than a cell, so marking
+    // each point's cell leaves no gaps in a line
+    for (const auto& player : state.players) {
+        for (int t = 0; t < TRAIL_TILE_COUNT; ++t) {
+            for (const auto& point : player.trail.tile(t)) {
+                int cx = static_cast<int>(point.pos.x) / OCCUPANCY_CELL, cy = static_cast<int>(point.pos.y) / OCCUPANCY_CELL;
+                if (point.pos.x >= 0 && point.pos.y >= 0 && cx < arenaWidth && cy < arenaHeight) grid[cy * gridWidth + cx] = BLOCKED;
+            }
+        }
+    }
+    // Circles: every cell whose center is inside, a row span at a time
+    for (const auto& circle : state.circles) {
+        float r = circle.radius / OCCUPANCY_CELL, cx = circle.pos.x / OCCUPANCY_CELL, cy = circle.pos.y / OCCUPANCY_CELL;
+        int y0 = std::max(0, static_cast<int>(std::ceil(cy - r - 0.5f))), y1 = std::min(arenaHeight - 1, static_cast<int>(std::floor(cy + r - 0.5f)));
+        for (int y = y0; y <= y1; ++y) {
+            float dy = y + 0.5f - cy;
+            float span = std::sqrt(std::max(0.0f, r * r - dy * dy));
+            int x0 = std::max(0, static_cast<int>(std::ceil(cx - span - 0.5f))), x1 = std::min(arenaWidth - 1, static_cast<int>(std::floor(cx + span - 0.5f)));
+            if (x0 <= x1) std::fill(grid + y * gridWidth + x0, grid + y * gridWidth + x1 + 1, BLOCKED);
+        }
+    }
+
+    for (int i = 1; i < OCCUPANCY_LEVELS; ++i) boxFilter2x2(levels[i - 1].data(), width(i - 1), height(i - 1), levels[i].data());
+}
+
+void observeHeads(const ObservationHead* heads, int count, float* out, int level) {
+    observeAll(heads, count, out, level);
+}
+
+void observeHeads(const ObservationHead* heads, int count, uint8_t* out, int level) {
+    observeAll(heads, count, out, level);
+}
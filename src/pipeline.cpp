@@ -0,0 +1,173 @@
+#include "pipeline.h"
+#include "affinity.h"
+#include "checkpoint.h"
+#include "profiler.h"
+#include "telemetry.h"
+#include <algorithm>
+#include <chrono>
+
+SimStage::SimStage(GameState& state, const GameConfig& config, CollisionBackend& collision, JobSystem& jobs, Telemetry& telemetry, bool threaded,
+                   int runAhead, int rewindTicks, CheckpointWriter* checkpoints)
+    : state(state), config(config), collision(collision), jobs(jobs), telemetry(telemetry), ownThread(threaded), runAhead(runAhead),
+      lastInputs{{0, 0}, {0, 0}}, lastDt(0), rewindRing(rewindTicks > 0 ? new RewindRing(rewindTicks) : nullptr), scrubTicks(-1), checkpoints(checkpoints),
+      nextCheckpointUs(state.simTimeUs + CHECKPOINT_INTERVAL_US), checkpointDue(false), inputs(INPUT_CAPACITY), ready(SNAPSHOT_COUNT), spare(SNAPSHOT_COUNT), shown(nullptr),
+      pendingEvents(0), pendingTickUs(0), pendingAheadUs(0), stopping(false) {
+    if (runAhead > 0) ahead = state; // Nothing predicted yet
+#ifdef LINES_NO_THREADS
+    ownThread = false;
+#else
+    if (!ownThread) return;
+    snapshots[0].state = state; // Something to draw before the first publish
+    drawScene(snapshots[0].list, state);
+    snapshots[0].events = 0;
+    snapshots[0].tickUs = 0;
+    snapshots[0].aheadUs = 0;
+    snapshots[0].scrubTicks = -1;
+    snapshots[0].rewindTicks = 0;
+    shown = &snapshots[0];
+    for (int i = 1; i < SNAPSHOT_COUNT; ++i) spare.push(&snapshots[i]);
+    thread = std::thread(&SimStage::simLoop, this);
+#endif
+}
+
+SimStage::~SimStage() {
+    stopping = true;
+#ifndef LINES_NO_THREADS
+    if (thread.joinable()) thread.join();
+#endif
+    while (step()) {} // Thread is gone; nothing else is popping
+}
+
+void SimStage::submit(const SimInput& input) {
+    while (!inputs.push(input)) {
+        if (!ownThread) pump();
+#ifndef LINES_NO_THREADS
+        else std::this_thread::yield();
+#endif
+    }
+}
+
+void SimStage::pump() {
+    if (ownThread) return; // Only the sim thread may pop inputs
+    bool stepped = false;
+    while (step()) stepped = true;
+    if (stepped && runAhead > 0 && scrubTicks < 0) predict(ahead);
+}
+
+SimFrame SimStage::latest() {
+    if (!ownThread) {
+        const GameState* shownState = scrubTicks >= 0 ? &scrubView : runAhead > 0 ? &ahead : &state;
+        SimFrame frame{shownState, nullptr, pendingEvents, pendingTickUs, pendingAheadUs, scrubTicks, rewindRing ? rewindRing->size() : 0};
+        pendingEvents = 0;
+        pendingTickUs = 0;
+        pendingAheadUs = 0;
+        return frame;
+    }
+    // Keep the newest snapshot, hand the rest back, and merge what they saw
+    SimFrame frame{nullptr, nullptr, 0, 0, 0, -1, 0};
+    Snapshot* next;
+    while (ready.pop(next)) {
+        spare.push(shown);
+        shown = next;
+        frame.events |= next->events;
+        frame.tickUs += next->tickUs;
+        frame.aheadUs += next->aheadUs;
+    }
+    frame.state = &shown->state;
+    frame.list = &shown->list;
+    frame.scrubTicks = shown->scrubTicks;
+    frame.rewindTicks = shown->rewindTicks;
+    return frame;
+}
+
+bool SimStage::step() {
+    SimInput input;
+    if (!inputs.pop(input)) return false;
+    if (input.type == SIM_CONFIG) {
+        applyConfig(state, config, input.config);
+        return true;
+    }
+    if (input.type == SIM_SCRUB) {
+        scrub(input.ticksBack);
+        return true;
+    }
+    scrubTicks = -1; // A frame or a rewind goes back to the live state
+    if (input.type == SIM_REWIND) {
+        if (rewindRing) rewindRing->rewind(input.ticksBack, state);
+        checkpointDue = true;
+        checkpoint();
+        return true;
+    }
+    PlayerInput players[2] = {{input.frame.triggers[0][0], input.frame.triggers[0][1]}, {input.frame.triggers[1][0], input.frame.triggers[1][1]}};
+    lastInputs[0] = players[0];
+    lastInputs[1] = players[1];
+    lastDt = input.frame.dt;
+    uint64_t start = profilerNowUs();
+    int events = stepGame(state, config, players, input.frame.dt, collision, &jobs);
+    pendingTickUs += profilerNowUs() - start;
+    pendingEvents |= events;
+    if (events & GAME_EVENT_ROUND_OVER) pushRoundTelemetry(telemetry, state);
+    if (rewindRing) rewindRing->capture(state);
+    if (events & (GAME_EVENT_COLLECTIBLE | GAME_EVENT_ROUND_OVER | GAME_EVENT_ROUND_START) || state.simTimeUs >= nextCheckpointUs) checkpointDue = true;
+    checkpoint();
+    return true;
+}
+
+void SimStage::checkpoint() {
+    if (!checkpoints || !checkpointDue || !checkpoints->submit(state)) return;
+    checkpointDue = false;
+    nextCheckpointUs = state.simTimeUs + CHECKPOINT_INTERVAL_US;
+}
+
+void SimStage::scrub(int ticksBack) {
+    if (!rewindRing || rewindRing->empty()) return;
+    scrubTicks = std::min(std::max(ticksBack, 0), rewindRing->size() - 1);
+    rewindRing->view(scrubTicks, scrubView);
+}
+
+void SimStage::predict(GameState& into) {
+    uint64_t start = profilerNowUs();
+    into = state; // Copy assignment reuses into's buffers
+    for (int i = 0; i < runAhead; ++i) stepGame(into, config, lastInputs, lastDt, aheadCollision, &jobs); // Events are guesses; dropped
+    pendingAheadUs += profilerNowUs() - start;
+}
+
+void SimStage::publish() {
+    Snapshot* snapshot;
+    if (!spare.pop(snapshot)) return; // Render holds them all; publish after the next batch
+    if (scrubTicks >= 0) snapshot->state = scrubView;
+    else if (runAhead > 0) predict(snapshot->state);
+    else snapshot->state = state; // Copy assignment reuses the snapshot's buffers
+    snapshot->list.clear();
+    drawScene(snapshot->list, snapshot->state); // Off the GL thread
+    snapshot->events = pendingEvents;
+    snapshot->tickUs = pendingTickUs;
+    snapshot->aheadUs = pendingAheadUs;
+    snapshot->scrubTicks = scrubTicks;
+    snapshot->rewindTicks = rewindRing ? rewindRing->size() : 0;
+    pendingEvents = 0;
+    pendingTickUs = 0;
+    pendingAheadUs = 0;
+    ready.push(snapshot);
+}
+
+void SimStage::simLoop() {
+#ifndef LINES_NO_THREADS
+    applyThreadRole(THREAD_SIM);
+    int idle = 0;
+    for (;;) {
+        bool stepped = false;
+        while (step()) stepped = true;
+        if (stepped) {
+            publish();
+            idle = 0;
+        } else if (stopping.load(std::memory_order_acquire)) {
+            break;
+        } else if (++idle < 64) {
+            std::this_thread::yield(); // A frame's input is usually a few hundred microseconds away
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    }
+#endif
+}
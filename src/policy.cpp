@@ -0,0 +1,196 @@
+#include "policy.h"
+#include "env.h"
+#include "jobs.h"
+#include "observe.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+int padded(int count) {
+    return (count + 3) & ~3;
+}
+
+// y = W x + b for rows and stride both multiples of 4; W is row major,
+// stride floats a row
+void matVec(const float* weights, const float* biases, int rows, int stride, const float* x, float* y) {
+#if defined(__SSE2__)
+    // Four rows share each load of x; their sums are transposed into one vector
+    for (int r = 0; r < rows; r += 4) {
+        const float* w = weights + static_cast<size_t>(r) * stride;
+        __m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps(), sum2 = _mm_setzero_ps(), sum3 = _mm_setzero_ps();
+        for (int c = 0; c < stride; c += 4) {
+            __m128 xs = _mm_loadu_ps(x + c);
+            sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(w + c), xs));
+            sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(w + stride + c), xs));
+            sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(w + 2 * stride + c), xs));
+            sum3 = _mm_add_ps(sum3, _mm_mul_ps(_mm_loadu_ps(w + 3 * stride + c), xs));
+        }
+        _MM_TRANSPOSE4_PS(sum0, sum1, sum2, sum3);
+        __m128 total = _mm_add_ps(_mm_add_ps(sum0, sum1), _mm_add_ps(sum2, sum3));
+        _mm_storeu_ps(y + r, _mm_add_ps(total, _mm_loadu_ps(biases + r)));
+    }
+#elif defined(__ARM_NEON)
+    for (int r = 0; r < rows; ++r) {
+        const float* w = weights + static_cast<size_t>(r) * stride;
+        float32x4_t sum = vdupq_n_f32(0.0f);
+        for (int c = 0; c < stride; c += 4) sum = vmlaq_f32(sum, vld1q_f32(w + c), vld1q_f32(x + c));
+        float32x2_t half = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+        y[r] = vget_lane_f32(vpadd_f32(half, half), 0) + biases[r];
+    }
+#else
+    for (int r = 0; r < rows; ++r) {
+        const float* w = weights + static_cast<size_t>(r) * stride;
+        float sum = 0;
+        for (int c = 0; c < stride; ++c) sum += w[c] * x[c];
+        y[r] = sum + biases[r];
+    }
+#endif
+}
+
+void activate(int activation, float* values, int count) {
+    if (activation == POLICY_RELU) {
+        for (int i = 0; i < count; ++i) values[i] = std::max(values[i], 0.0f);
+    } else if (activation == POLICY_TANH) {
+        for (int i = 0; i < count; ++i) values[i] = std::tanh(values[i]);
+    }
+}
+
+uint32_t readU32(const uint8_t* data) { // Native order, see policy.h
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+bool readFile(const std::string& path, std::vector<uint8_t>& data) {
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+    data.clear();
+    uint8_t chunk[65536];
+    size_t got;
+    while ((got = std::fread(chunk, 1, sizeof(chunk), file)) > 0) data.insert(data.end(), chunk, chunk + got);
+    std::fclose(file);
+    return true;
+}
+
+} // namespace
+
+bool Policy::load(const std::string& path) {
+    std::vector<uint8_t> data;
+    if (!readFile(path, data)) data.clear(); // Parsing nothing empties the policy
+    return parse(data.data(), data.size());
+}
+
+bool Policy::parse(const uint8_t* data, size_t size) {
+    layers.clear();
+    params.clear();
+    inputCount = widest = 0;
+    if (size < 16 || readU32(data) != POLICY_MAGIC || readU32(data + 4) != POLICY_VERSION) return false;
+    uint32_t layerCount = readU32(data + 8), in = readU32(data + 12);
+    if (layerCount < 1 || layerCount > POLICY_MAX_LAYERS || in < 1 || in > POLICY_MAX_WIDTH) return false;
+
+    std::vector<Layer> parsed;
+    std::vector<float> values;
+    int widestPadded = padded(static_cast<int>(in));
+    size_t at = 16;
+    for (uint32_t i = 0; i < layerCount; ++i) {
+        if (size - at < 8) return false;
+        uint32_t out = readU32(data + at), activation = readU32(data + at + 4);
+        at += 8;
+        if (out < 1 || out > POLICY_MAX_WIDTH || activation > POLICY_TANH) return false;
+        if ((size - at) / sizeof(float) < (static_cast<uint64_t>(in) + 1) * out) return false; // Weights and biases are all there
+        Layer layer;
+        layer.outputs = static_cast<int>(out);
+        layer.activation = static_cast<int>(activation);
+        layer.rows = padded(layer.outputs);
+        layer.stride = padded(static_cast<int>(in));
+        layer.weights = values.size();
+        layer.biases = layer.weights + static_cast<size_t>(layer.rows) * layer.stride;
+        values.resize(layer.biases + layer.rows, 0.0f); // Padding stays zero, so padded outputs are too
+        for (uint32_t r = 0; r < out; ++r) {
+            std::memcpy(&values[layer.weights + static_cast<size_t>(r) * layer.stride], data + at, in * sizeof(float));
+            at += in * sizeof(float);
+        }
+        std::memcpy(&values[layer.biases], data + at, out * sizeof(float));
+        at += out * sizeof(float);
+        widestPadded = std::max(widestPadded, layer.rows);
+        parsed.push_back(layer);
+        in = out;
+    }
+    if (at != size) return false;
+    for (float value : values) {
+        if (!std::isfinite(value)) return false; // One NaN would spread to every output after it
+    }
+    inputCount = static_cast<int>(readU32(data + 12));
+    widest = widestPadded;
+    layers.swap(parsed);
+    params.swap(values);
+    return true;
+}
+
+void Policy::evaluate(const float* input, float* output) const {
+    // Two activation buffers, ping-ponged through the layers
+    static LINES_THREAD_LOCAL std::vector<float> scratch;
+    if (scratch.size() < static_cast<size_t>(widest) * 2) scratch.resize(static_cast<size_t>(widest) * 2);
+    float* x = scratch.data();
+    float* y = x + widest;
+    std::memcpy(x, input, inputCount * sizeof(float));
+    std::fill(x + inputCount, x + padded(inputCount), 0.0f);
+    for (const auto& layer : layers) {
+        matVec(&params[layer.weights], &params[layer.biases], layer.rows, layer.stride, x, y);
+        activate(layer.activation, y, layer.rows);
+        std::swap(x, y);
+    }
+    std::memcpy(output, x, outputs() * sizeof(float));
+}
+
+void Policy::evaluate(const float* inputs, int count, float* outputs) const {
+    for (int i = 0; i < count; ++i) evaluate(inputs + static_cast<size_t>(i) * inputCount, outputs + static_cast<size_t>(i) * this->outputs());
+}
+
+PlayerInput policyAction(const float* outputs) {
+    int16_t triggers[2];
+    for (int i = 0; i < 2; ++i) {
+        float value = std::isfinite(outputs[i]) ? outputs[i] : 0.0f; // NaN would survive the clamp, and its cast is undefined
+        triggers[i] = static_cast<int16_t>(std::min(std::max(value, 0.0f), 1.0f) * 32767);
+    }
+    return PlayerInput{triggers[0], triggers[1]};
+}
+
+PolicyBot::PolicyBot(const Policy& policy, int player, uint64_t thinkIntervalUs)
+    : policy(policy), player(player), interval(thinkIntervalUs), nextThinkUs(0), held{0, 0},
+      input(policy.inputs()), output(policy.outputs()) {
+    if (policy.inputs() == OBS_GRID_CELLS) map.reset(new OccupancyMap());
+}
+
+PolicyBot::~PolicyBot() {}
+
+bool PolicyBot::accepts(const Policy& policy) {
+    return policy.outputs() >= 2 && (policy.inputs() == ENV_OBS_SIZE || policy.inputs() == OBS_GRID_CELLS);
+}
+
+PlayerInput PolicyBot::think(const GameState& state, const GameConfig& config) {
+    const Player& self = state.players[player];
+    if (state.gameOver || !self.alive) return PlayerInput{0, 0};
+    if (state.simTimeUs < nextThinkUs) return held;
+    nextThinkUs = state.simTimeUs + interval;
+
+    if (map) {
+        map->build(state);
+        ObservationHead head{map.get(), self.pos, self.direction};
+        observeHeads(&head, 1, input.data());
+    } else {
+        observeFeatures(state, config, player, probe, input.data());
+    }
+    policy.evaluate(input.data(), output.data());
+    held = policyAction(output.data());
+    if (!self.hasMoved && held.leftTrigger == 0 && held.rightTrigger == 0) held = PlayerInput{1, 1}; // As Bot: straight on still ends spawn immunity
+    return held;
+}
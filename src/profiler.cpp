@@ -0,0 +1,96 @@
+#include "profiler.h"
+#include <algorithm>
+#include <chrono>
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__) && !defined(__DJGPP__)
+#define LINES_RUSAGE
+#include <sys/resource.h>
+#endif
+
+uint64_t profilerNowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t profilerContextSwitches() {
+#ifdef LINES_RUSAGE
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) return usage.ru_nivcsw;
+#endif
+    return 0;
+}
+
+Profiler::Profiler(float stutterMs)
+    : stutterMs(stutterMs), frameCount(0), frameStart(0), lastFrameUs(0), frameSwitches(0), lastSwitches(0), totalSwitches(0), zoneStart(), zoneUs(), lastGpuNs(), totalGpuNs(), gpuFrames(0), lastDraw(), totalDraw(), drawFrames(0), snapshots(), stutterCount(0) {}
+
+void Profiler::beginFrame() {
+    frameStart = profilerNowUs();
+    frameSwitches = profilerContextSwitches();
+    std::fill(zoneUs, zoneUs + PROFILE_ZONE_COUNT, 0);
+}
+
+bool Profiler::endFrame(const GameState& state) {
+    lastFrameUs = profilerNowUs() - frameStart;
+    lastSwitches = static_cast<uint32_t>(profilerContextSwitches() - frameSwitches);
+    totalSwitches += lastSwitches;
+    frames.record(lastFrameUs);
+    ticks.record(zoneUs[ZONE_TICK]);
+    frameCount++;
+    if (lastFrameUs <= stutterMs * 1000.0f) return false;
+
+    StutterSnapshot& snapshot = snapshots[stutterCount++ % SNAPSHOT_COUNT];
+    snapshot.frame = frameCount - 1;
+    snapshot.simTimeUs = state.simTimeUs;
+    snapshot.frameMs = frameMs();
+    for (int i = 0; i < PROFILE_ZONE_COUNT; ++i) snapshot.zoneMs[i] = zoneUs[i] / 1000.0f;
+    snapshot.contextSwitches = lastSwitches;
+    snapshot.trailPoints[0] = state.players[0].trail.size();
+    snapshot.trailPoints[1] = state.players[1].trail.size();
+    snapshot.circles = state.circles.size();
+    return true;
+}
+
+void Profiler::addGpuFrame(const uint64_t ns[GPU_ZONE_COUNT]) {
+    for (int i = 0; i < GPU_ZONE_COUNT; ++i) {
+        lastGpuNs[i] = ns[i];
+        totalGpuNs[i] += ns[i];
+    }
+    gpuFrames++;
+}
+
+void Profiler::setDrawStats(const DrawStats& stats) {
+    lastDraw = stats;
+    const uint32_t fields[6] = {stats.drawCalls, stats.vertices, stats.stateChanges, stats.redundantCalls, stats.bytesUploaded, stats.bytesRead};
+    for (int i = 0; i < 6; ++i) totalDraw[i] += fields[i];
+    drawFrames++;
+}
+
+void Profiler::dump(FILE* out) const {
+    const Histogram* histograms[] = {&frames, &ticks};
+    const char* names[] = {"frame", "tick"};
+    std::fprintf(out, "%-6s %8s %8s %8s %8s %8s\n", "ms", "count", "p50", "p99", "p99.9", "max");
+    for (int i = 0; i < 2; ++i) {
+        const Histogram& h = *histograms[i];
+        std::fprintf(out, "%-6s %8llu %8.2f %8.2f %8.2f %8.2f\n", names[i], static_cast<unsigned long long>(h.count()),
+                     h.percentile(50) / 1000.0, h.percentile(99) / 1000.0, h.percentile(99.9) / 1000.0, h.max() / 1000.0);
+    }
+    if (gpuFrames) {
+        std::fprintf(out, "gpu ms, mean over %llu frames [", static_cast<unsigned long long>(gpuFrames));
+        for (int z = 0; z < GPU_ZONE_COUNT; ++z) std::fprintf(out, "%s%s %.3f", z ? ", " : "", GPU_ZONE_NAMES[z], totalGpuNs[z] / 1e6 / gpuFrames);
+        std::fprintf(out, "]\n");
+    }
+    if (drawFrames) {
+        double n = static_cast<double>(drawFrames);
+        std::fprintf(out, "gl per frame: %.1f draws, %.0f vertices, %.1f state changes (%.1f redundant dropped), %.1fKB up, %.1fKB read\n",
+                     totalDraw[0] / n, totalDraw[1] / n, totalDraw[2] / n, totalDraw[3] / n, totalDraw[4] / n / 1024, totalDraw[5] / n / 1024);
+    }
+    std::fprintf(out, "involuntary context switches: %llu, %.2f per frame\n", static_cast<unsigned long long>(totalSwitches),
+                 frameCount ? static_cast<double>(totalSwitches) / frameCount : 0.0);
+    uint64_t kept = std::min<uint64_t>(stutterCount, SNAPSHOT_COUNT);
+    std::fprintf(out, "%llu stutters over %gms", static_cast<unsigned long long>(stutterCount), stutterMs);
+    std::fprintf(out, kept ? ", most recent:\n" : "\n");
+    for (uint64_t i = stutterCount - kept; i < stutterCount; ++i) {
+        const StutterSnapshot& s = snapshots[i % SNAPSHOT_COUNT];
+        std::fprintf(out, "  frame %llu t=%.3fs %.2fms [", static_cast<unsigned long long>(s.frame), s.simTimeUs / 1e6, s.frameMs);
+        for (int z = 0; z < PROFILE_ZONE_COUNT; ++z) std::fprintf(out, "%s%s %.2f", z ? ", " : "", PROFILE_ZONE_NAMES[z], s.zoneMs[z]);
+        std::fprintf(out, "] switched %u, trail %u+%u circles %u\n", s.contextSwitches, s.trailPoints[0], s.trailPoints[1], s.circles);
+    }
+}
@@ -0,0 +1,207 @@
+#include "render.h"
+#include "gputimer.h"
+#include "glstate.h"
+#include <SDL2/SDL.h>
+#include <GL/gl.h>
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+namespace {
+
+const std::map<char, std::vector<bool>> FONT = {
+    {'0', {1,1,1,1,1, 1,0,0,0,1, 1,0,0,0,1, 1,0,0,0,1, 1,1,1,1,1}},
+    {'1', {0,0,1,0,0, 0,0,1,0,0, 0,0,1,0,0, 0,0,1,0,0, 0,0,1,0,0}},
+    {'2', {1,1,1,1,1, 0,0,0,0,1, 1,1,1,1,1, 1,0,0,0,0, 1,1,1,1,1}},
+    {'3', {1,1,1,1,1, 0,0,0,0,1, 1,1,1,1,1, 0,0,0,0,1, 1,1,1,1,1}},
+    {'4', {1,0,0,0,1, 1,0,0,0,1, 1,1,1,1,1, 0,0,0,0,1, 0,0,0,0,1}},
+    {'5', {1,1,1,1,1, 1,0,0,0,0, 1,1,1,1,1, 0,0,0,0,1, 1,1,1,1,1}},
+    {'6', {1,1,1,1,1, 1,0,0,0,0, 1,1,1,1,1, 1,0,0,0,1, 1,1,1,1,1}},
+    {'7', {1,1,1,1,1, 0,0,0,0,1, 0,0,0,0,1, 0,0,0,0,1, 0,0,0,0,1}},
+    {'8', {1,1,1,1,1, 1,0,0,0,1, 1,1,1,1,1, 1,0,0,0,1, 1,1,1,1,1}},
+    {'9', {1,1,1,1,1, 1,0,0,0,1, 1,1,1,1,1, 0,0,0,0,1, 1,1,1,1,1}},
+    {'-', {0,0,0,0,0, 0,0,0,0,0, 1,1,1,1,1, 0,0,0,0,0, 0,0,0,0,0}},
+    {' ', {0,0,0,0,0, 0,0,0,0,0, 0,0,0,0,0, 0,0,0,0,0, 0,0,0,0,0}}
+};
+
+const int CIRCLE_SEGMENTS = 360; // One vertex per degree, as the immediate-mode fan had
+
+uint64_t commandKey(int layer, DrawShape shape, const Color& color) {
+    return static_cast<uint64_t>(layer) << 40 | static_cast<uint64_t>(shape) << 32 | color.r << 16 | color.g << 8 | color.b;
+}
+
+} // namespace
+
+void RenderList::clear() {
+    commands.clear(); // Both keep capacity, so a steady frame allocates nothing
+    items.clear();
+}
+
+void RenderList::add(int layer, DrawShape shape, const Color& color, const DrawItem& item) {
+    uint64_t key = commandKey(layer, shape, color);
+    uint32_t index = static_cast<uint32_t>(items.size());
+    items.push_back(item);
+    if (!commands.empty() && commands.back().key == key && commands.back().first + commands.back().count == index) {
+        commands.back().count++;
+        return;
+    }
+    commands.push_back(DrawCommand{key, index, 1});
+}
+
+void RenderList::sort() {
+    std::stable_sort(commands.begin(), commands.end(), [](const DrawCommand& a, const DrawCommand& b) { return a.key < b.key; });
+}
+
+void RenderList::square(int layer, const Color& color, float x, float y, float size) {
+    add(layer, SHAPE_SQUARE, color, DrawItem{x, y, size});
+}
+
+void RenderList::circle(int layer, const Color& color, float x, float y, float radius) {
+    add(layer, SHAPE_CIRCLE, color, DrawItem{x, y, radius});
+}
+
+void drawSquare(RenderList& list, int layer, float x, float y, float size, const Color& color) {
+    list.square(layer, color, x, y, size);
+}
+
+void drawCircle(RenderList& list, int layer, float x, float y, float radius, const Color& color) {
+    list.circle(layer, color, x, y, radius);
+}
+
+void drawText(RenderList& list, const std::string& text, float x, float y, float squareSize, const Color& color) {
+    float charWidth = squareSize * 6;
+    for (size_t i = 0; i < text.size(); ++i) {
+        auto glyph = FONT.find(text[i]);
+        if (glyph == FONT.end()) continue;
+        const auto& pattern = glyph->second;
+        float startX = x + i * charWidth;
+        for (int row = 0; row < 5; ++row) {
+            for (int col = 0; col < 5; ++col) {
+                if (pattern[row * 5 + col]) {
+                    drawSquare(list, LAYER_TEXT, startX + col * squareSize, y + row * squareSize, squareSize, color);
+                }
+            }
+        }
+    }
+}
+
+void drawPlayer(RenderList& list, const Player& player) {
+    drawSquare(list, LAYER_PLAYERS, player.pos.x - PLAYER_SIZE / 2, player.pos.y - PLAYER_SIZE / 2, PLAYER_SIZE, player.color);
+}
+
+void drawTrail(RenderList& list, int layer, const Player& player, int skipRecent) {
+    float halfSize = TRAIL_SIZE / 2.0f;
+    for (int t = 0; t < TRAIL_TILE_COUNT; ++t) {
+        for (const auto& point : player.trail.tile(t)) {
+            if (skipRecent > 0 && player.trail.recent(point, skipRecent)) continue;
+            list.square(layer, player.color, point.pos.x - halfSize, point.pos.y - halfSize, TRAIL_SIZE);
+        }
+    }
+}
+
+void drawScore(RenderList& list, const GameState& state) {
+    std::string scoreText = std::to_string(state.scores[0]) + "-" + std::to_string(state.scores[1]);
+    float squareSize = 10.0f;
+    float textWidth = scoreText.size() * squareSize * 6;
+    drawText(list, scoreText, (WIDTH - textWidth) / 2, HEIGHT / 2 - 25, squareSize, {255, 255, 255, 255});
+}
+
+void drawScene(RenderList& list, const GameState& state) {
+    if (state.gameOver) {
+        // Show score and countdown during game over
+        drawScore(list, state);
+        if (state.countdown >= 1) {
+            float squareSize = 10.0f;
+            drawText(list, std::to_string(state.countdown), (WIDTH - squareSize * 6) / 2, HEIGHT / 2 + 25, squareSize, {255, 255, 255, 255});
+        }
+        return;
+    }
+    const Collectible& collectible = state.collectible;
+    drawSquare(list, LAYER_COLLECTIBLE_BACK, collectible.pos.x - collectible.blackSquareSize / 2, collectible.pos.y - collectible.blackSquareSize / 2,
+               collectible.blackSquareSize, {0, 0, 0, 255}); // Black square
+    drawCircle(list, LAYER_COLLECTIBLE_BACK, collectible.pos.x, collectible.pos.y, collectible.blackCircleSize, {0, 0, 0, 255}); // Black circle
+    drawSquare(list, LAYER_COLLECTIBLE, collectible.pos.x - collectible.size / 2, collectible.pos.y - collectible.size / 2,
+               collectible.size, {0, 255, 0, 255}); // Green square
+    for (const auto& circle : state.circles) drawCircle(list, LAYER_CIRCLES, circle.pos.x, circle.pos.y, circle.radius, {255, 255, 0, 255}); // Yellow circles
+    drawTrail(list, LAYER_TRAILS, state.players[0]); // Blue trail
+    drawTrail(list, LAYER_TRAILS + 1, state.players[1]); // Red trail
+    drawPlayer(list, state.players[0]); // Blue player
+    drawPlayer(list, state.players[1]); // Red player
+}
+
+void drawOverlay(RenderList& list, const Profiler& profiler) {
+    // One number per row: frame ms, then with GL stats draw calls, vertices, state changes, KB uploaded
+    const float squareSize = 3.0f;
+    const DrawStats& stats = profiler.drawStats();
+    const uint32_t rows[] = {static_cast<uint32_t>(profiler.frameMs() + 0.5f), stats.drawCalls, stats.vertices, stats.stateChanges, stats.bytesUploaded / 1024};
+    int count = profiler.hasDrawStats() ? 5 : 1;
+    for (int i = 0; i < count; ++i) {
+        drawText(list, std::to_string(rows[i]), 10, 10 + i * squareSize * 7, squareSize, {255, 255, 255, 255});
+    }
+}
+
+void drawRewind(RenderList& list, int ticksBack, int ticksHeld) {
+    // One square per REWIND_BAR_SEGMENTS-th of the ring, newest on the right; the shown tick is white
+    const int REWIND_BAR_SEGMENTS = 96;
+    const float segment = static_cast<float>(WIDTH) / REWIND_BAR_SEGMENTS, size = 8.0f;
+    int held = std::max(ticksHeld, 1);
+    int shown = REWIND_BAR_SEGMENTS - 1 - ticksBack * REWIND_BAR_SEGMENTS / held;
+    int oldest = REWIND_BAR_SEGMENTS - 1 - (held - 1) * REWIND_BAR_SEGMENTS / held;
+    for (int i = oldest; i < REWIND_BAR_SEGMENTS; ++i) {
+        Color color = i == shown ? Color{255, 255, 255, 255} : Color{96, 96, 96, 255};
+        drawSquare(list, LAYER_TEXT, i * segment + (segment - size) / 2, 10, size, color);
+    }
+}
+
+GpuZone layerZone(int layer) {
+    if (layer <= LAYER_COLLECTIBLE) return GPU_ZONE_COLLECTIBLE;
+    if (layer == LAYER_CIRCLES) return GPU_ZONE_CIRCLES;
+    if (layer < LAYER_TEXT) return GPU_ZONE_TRAILS;
+    return GPU_ZONE_TEXT;
+}
+
+void submitRenderList(RenderList& list, GpuTimer* timer) {
+    static float unitX[CIRCLE_SEGMENTS], unitY[CIRCLE_SEGMENTS];
+    static bool unitReady = false;
+    if (!unitReady) {
+        for (int i = 0; i < CIRCLE_SEGMENTS; i++) {
+            float rad = i * M_PI / 180.0f;
+            unitX[i] = cos(rad);
+            unitY[i] = sin(rad);
+        }
+        unitReady = true;
+    }
+
+    list.sort();
+    const std::vector<DrawCommand>& commands = list.commandList();
+    const std::vector<DrawItem>& items = list.itemList();
+    for (size_t c = 0; c < commands.size();) {
+        uint64_t key = commands[c].key;
+        DrawShape shape = keyShape(key);
+        Color color = keyColor(key);
+        if (timer) timer->begin(layerZone(keyLayer(key)));
+        glState.color(color.r, color.g, color.b);
+        glState.begin(shape == SHAPE_SQUARE ? GL_QUADS : GL_TRIANGLES); // Keeps the batch across colors
+        for (; c < commands.size() && commands[c].key == key; ++c) {
+            const DrawCommand& command = commands[c];
+            for (uint32_t i = command.first; i < command.first + command.count; ++i) {
+                const DrawItem& item = items[i];
+                if (shape == SHAPE_SQUARE) {
+                    glState.vertex(item.x, item.y);
+                    glState.vertex(item.x + item.size, item.y);
+                    glState.vertex(item.x + item.size, item.y + item.size);
+                    glState.vertex(item.x, item.y + item.size);
+                    continue;
+                }
+                // The fan as separate triangles, so circles batch too
+                for (int k = 1; k + 1 < CIRCLE_SEGMENTS; ++k) {
+                    glState.vertex(item.x + unitX[0] * item.size, item.y + unitY[0] * item.size);
+                    glState.vertex(item.x + unitX[k] * item.size, item.y + unitY[k] * item.size);
+                    glState.vertex(item.x + unitX[k + 1] * item.size, item.y + unitY[k + 1] * item.size);
+                }
+            }
+        }
+    }
+    glState.flush();
+    if (timer) timer->end();
+}
@@ -0,0 +1,134 @@
+#include "replay.h"
+#include <vector>
+
+namespace {
+
+void writeString(FILE* file, const std::string& text) {
+    uint32_t size = static_cast<uint32_t>(text.size());
+    fwrite(&size, sizeof(size), 1, file);
+    fwrite(text.data(), 1, size, file);
+}
+
+bool readString(FILE* file, std::string& text) {
+    uint32_t size;
+    if (fread(&size, sizeof(size), 1, file) != 1 || size > 65536) return false;
+    std::vector<char> buffer(size);
+    if (size && fread(buffer.data(), 1, size, file) != size) return false;
+    text.assign(buffer.begin(), buffer.end());
+    return true;
+}
+
+} // namespace
+
+bool ReplayWriter::open(const std::string& path, uint32_t seed, const GameConfig& config, ReplayCollision collision, const GameState* start) {
+    close();
+    file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+    fwrite(&REPLAY_MAGIC, sizeof(REPLAY_MAGIC), 1, file);
+    fwrite(&REPLAY_VERSION, sizeof(REPLAY_VERSION), 1, file);
+    fwrite(&seed, sizeof(seed), 1, file);
+    writeString(file, formatConfig(config));
+    std::vector<uint8_t> snapshot;
+    if (start) writeSnapshot(*start, snapshot);
+    uint64_t size = snapshot.size(); // 0: newGame from the seed
+    fwrite(&size, sizeof(size), 1, file);
+    if (size) fwrite(snapshot.data(), 1, snapshot.size(), file);
+    uint8_t backend = static_cast<uint8_t>(collision);
+    fwrite(&backend, 1, 1, file);
+    return true;
+}
+
+void ReplayWriter::writeFrame(const ReplayFrame& frame) {
+    if (!file) return;
+    uint8_t type = REPLAY_FRAME;
+    fwrite(&type, 1, 1, file);
+    fwrite(&frame.dt, sizeof(frame.dt), 1, file);
+    fwrite(frame.triggers, sizeof(frame.triggers), 1, file);
+}
+
+void ReplayWriter::writeConfig(const GameConfig& config) {
+    if (!file) return;
+    uint8_t type = REPLAY_CONFIG;
+    fwrite(&type, 1, 1, file);
+    writeString(file, formatConfig(config));
+}
+
+void ReplayWriter::close() {
+    if (file) fclose(file);
+    file = nullptr;
+}
+
+bool ReplayReader::open(const std::string& path) {
+    close();
+    file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+    uint32_t magic = 0, version = 0;
+    uint64_t startSize = 0;
+    uint8_t backend = REPLAY_COLLISION_UNKNOWN;
+    std::string text;
+    config = GameConfig();
+    start = SnapshotView();
+    if (fread(&magic, sizeof(magic), 1, file) != 1 || magic != REPLAY_MAGIC ||
+        fread(&version, sizeof(version), 1, file) != 1 || version < 2 || version > REPLAY_VERSION ||
+        fread(&seed, sizeof(seed), 1, file) != 1 || !readString(file, text) ||
+        (version >= 3 && fread(&startSize, sizeof(startSize), 1, file) != 1)) {
+        close();
+        return false;
+    }
+    if (startSize > 0x7fffffff) { // Far past any arena; a bad header
+        close();
+        return false;
+    }
+    if (startSize) {
+        startData.resize(startSize);
+        if (fread(startData.data(), 1, startSize, file) != startSize || !start.open(startData.data(), startData.size())) {
+            close();
+            return false;
+        }
+    }
+    if (version >= 4 && (fread(&backend, 1, 1, file) != 1 || backend > REPLAY_COLLISION_OCCLUSION)) {
+        close();
+        return false;
+    }
+    collision = static_cast<ReplayCollision>(backend);
+    parseConfig(text, config);
+    return true;
+}
+
+void ReplayReader::startMatch(GameState& state) const {
+    if (start.isOpen()) start.restore(state);
+    else newGame(state, config, seed);
+}
+
+ReplayRecord ReplayReader::next(ReplayFrame& frame, GameConfig& current) {
+    if (!file) return REPLAY_END;
+    uint8_t type;
+    if (fread(&type, 1, 1, file) != 1) return REPLAY_END;
+    if (type == REPLAY_FRAME) {
+        if (fread(&frame.dt, sizeof(frame.dt), 1, file) == 1 &&
+            fread(frame.triggers, sizeof(frame.triggers), 1, file) == 1) return REPLAY_FRAME;
+    } else if (type == REPLAY_CONFIG) {
+        std::string text;
+        if (readString(file, text)) {
+            current = GameConfig();
+            parseConfig(text, current);
+            return REPLAY_CONFIG;
+        }
+    }
+    return REPLAY_ERROR;
+}
+
+void ReplayReader::close() {
+    if (file) fclose(file);
+    file = nullptr;
+}
+
+CollisionBackend* playbackCollision(const ReplayReader& replay, CpuCollision& cpu, LateCollision& late) {
+    switch (replay.collisionUsed()) {
+    case REPLAY_COLLISION_CPU:
+    case REPLAY_COLLISION_READBACK:
+    case REPLAY_COLLISION_IDS: return &cpu; // Same pixels, same tick
+    case REPLAY_COLLISION_OCCLUSION: return &late;
+    default: return nullptr;
+    }
+}
@@ -0,0 +1,112 @@
+#include "rewind.h"
+#include <algorithm>
+
+RewindRing::RewindRing(int capacityTicks) : first(0), next(0) {
+    int groups = std::max(1, (capacityTicks + KEYFRAME_INTERVAL - 1) / KEYFRAME_INTERVAL);
+    capacity = groups * KEYFRAME_INTERVAL;
+    deltas.resize(capacity);
+    keyframes.resize(groups);
+}
+
+void RewindRing::clear() {
+    first = next = 0;
+}
+
+void RewindRing::capture(GameState& state) {
+    if (size() == capacity) first += KEYFRAME_INTERVAL; // Frees the oldest group, including the keyframe about to be reused
+    if (next % KEYFRAME_INTERVAL == 0) {
+        keyframes[next / KEYFRAME_INTERVAL % keyframes.size()] = state; // Copy assignment reuses the keyframe's buffers
+    } else {
+        saveDelta(state, deltas[next % capacity]);
+    }
+    for (auto& player : state.players) player.trail.clearDirty();
+    next++;
+}
+
+void RewindRing::saveDelta(GameState& state, Delta& delta) {
+    delta.tiles.clear();
+    delta.points.clear();
+    for (int i = 0; i < 2; ++i) {
+        const Player& player = state.players[i];
+        delta.heads[i] = HeadState{player.pos, player.direction, player.alive, player.willDie, player.hasMoved, player.killedBy, player.trail.cursor()};
+        for (int t = 0; t < TRAIL_TILE_COUNT; ++t) {
+            if (!player.trail.dirty(t)) continue;
+            const auto& points = player.trail.tile(t);
+            delta.tiles.push_back(TileChange{static_cast<uint16_t>(i), static_cast<uint16_t>(t), static_cast<uint32_t>(points.size())});
+            delta.points.insert(delta.points.end(), points.begin(), points.end());
+        }
+    }
+    delta.circles = state.circles;
+    delta.collectible = state.collectible;
+    std::copy(state.scores, state.scores + 2, delta.scores);
+    delta.gameOver = state.gameOver;
+    delta.countdown = state.countdown;
+    std::copy(state.rng, state.rng + RNG_STREAM_COUNT, delta.rng);
+    state.scheduler.save(delta.scheduler);
+    delta.simTimeUs = state.simTimeUs;
+    delta.roundStartUs = state.roundStartUs;
+    delta.spawnTimer = state.spawnTimer;
+    delta.countdownTimer = state.countdownTimer;
+}
+
+void RewindRing::applyDelta(const Delta& delta, GameState& state) {
+    const TrailPoint* points = delta.points.data();
+    for (const auto& change : delta.tiles) {
+        state.players[change.player].trail.setTile(change.tile, points, change.count);
+        points += change.count;
+    }
+    for (int i = 0; i < 2; ++i) {
+        Player& player = state.players[i];
+        const HeadState& head = delta.heads[i];
+        player.pos = head.pos;
+        player.direction = head.direction;
+        player.alive = head.alive;
+        player.willDie = head.willDie;
+        player.hasMoved = head.hasMoved;
+        player.killedBy = head.killedBy;
+        player.trail.setCursor(head.cursor);
+    }
+    state.circles = delta.circles;
+    state.collectible = delta.collectible;
+    std::copy(delta.scores, delta.scores + 2, state.scores);
+    state.gameOver = delta.gameOver;
+    state.countdown = delta.countdown;
+    std::copy(delta.rng, delta.rng + RNG_STREAM_COUNT, state.rng);
+    state.scheduler.load(delta.scheduler);
+    state.simTimeUs = delta.simTimeUs;
+    state.roundStartUs = delta.roundStartUs;
+    state.spawnTimer = delta.spawnTimer;
+    state.countdownTimer = delta.countdownTimer;
+}
+
+bool RewindRing::view(int ticksBack, GameState& out) const {
+    if (empty()) return false;
+    uint64_t tick = next - 1 - std::min<uint64_t>(std::max(ticksBack, 0), next - 1 - first);
+    uint64_t key = tick - tick % KEYFRAME_INTERVAL;
+    out = keyframes[key / KEYFRAME_INTERVAL % keyframes.size()];
+    for (uint64_t t = key + 1; t <= tick; ++t) applyDelta(deltas[t % capacity], out);
+    return true;
+}
+
+bool RewindRing::rewind(int ticksBack, GameState& out) {
+    if (!view(ticksBack, out)) return false;
+    next -= std::min<uint64_t>(std::max(ticksBack, 0), next - 1 - first);
+    for (auto& player : out.players) player.trail.clearDirty(); // In step with the newest entry again
+    return true;
+}
+
+size_t RewindRing::bytes() const {
+    size_t total = 0;
+    for (uint64_t t = first; t < next; ++t) {
+        if (t % KEYFRAME_INTERVAL == 0) {
+            const GameState& key = keyframes[t / KEYFRAME_INTERVAL % keyframes.size()];
+            total += sizeof(GameState) + (key.players[0].trail.size() + key.players[1].trail.size()) * sizeof(TrailPoint) +
+                     key.circles.size() * sizeof(Circle) + key.scheduler.pending() * sizeof(Timer);
+        } else {
+            const Delta& delta = deltas[t % capacity];
+            total += sizeof(Delta) + delta.tiles.size() * sizeof(TileChange) + delta.points.size() * sizeof(TrailPoint) +
+                     delta.circles.size() * sizeof(Circle) + delta.scheduler.timers.size() * sizeof(Timer);
+        }
+    }
+    return total;
+}
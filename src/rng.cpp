@@ -0,0 +1,27 @@
+#include "rng.h"
+
+void Rng::seed(uint64_t seedValue, uint64_t stream) {
+    // The reference pcg32_srandom_r
+    state = 0;
+    increment = stream << 1 | 1;
+    (*this)();
+    state += seedValue;
+    (*this)();
+}
+
+void Rng::advance(uint64_t steps) {
+    // Brown's jump ahead for LCGs: compose the step x -> a*x + c with itself
+    // by squaring, folding in the powers the step count's bits select
+    uint64_t accMult = 1, accPlus = 0;
+    uint64_t curMult = MULTIPLIER, curPlus = increment;
+    while (steps > 0) {
+        if (steps & 1) {
+            accMult *= curMult;
+            accPlus = accPlus * curMult + curPlus;
+        }
+        curPlus = (curMult + 1) * curPlus;
+        curMult *= curMult;
+        steps >>= 1;
+    }
+    state = accMult * state + accPlus;
+}
@@ -0,0 +1,98 @@
+#include "scheduler.h"
+#include <algorithm>
+
+Scheduler::Scheduler() : slots(SLOT_COUNT), nowUs(0), cursorTick(0), nextId(1), count(0) {}
+
+TimerId Scheduler::schedule(uint64_t delayUs, int type, int arg) {
+    Timer timer{nextId++, type, arg, nowUs + delayUs, 0};
+    if (nextId == INVALID_TIMER) nextId = 1;
+    insert(timer);
+    return timer.id;
+}
+
+TimerId Scheduler::scheduleRepeating(uint64_t intervalUs, int type, int arg) {
+    Timer timer{nextId++, type, arg, nowUs + intervalUs, std::max<uint64_t>(intervalUs, 1)};
+    if (nextId == INVALID_TIMER) nextId = 1;
+    insert(timer);
+    return timer.id;
+}
+
+bool Scheduler::cancel(TimerId id) {
+    if (id == INVALID_TIMER) return false;
+    for (auto& slot : slots) {
+        for (size_t i = 0; i < slot.size(); ++i) {
+            if (slot[i].id != id) continue;
+            slot.erase(slot.begin() + i);
+            count--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Scheduler::clear() {
+    for (auto& slot : slots) slot.clear(); // Keeps capacity
+    count = 0;
+}
+
+void Scheduler::reset() {
+    clear();
+    nowUs = 0;
+    cursorTick = 0;
+}
+
+void Scheduler::save(Saved& out) const {
+    out.nowUs = nowUs;
+    out.cursorTick = cursorTick;
+    out.nextId = nextId;
+    out.timers.clear();
+    for (const auto& slot : slots) out.timers.insert(out.timers.end(), slot.begin(), slot.end());
+}
+
+void Scheduler::load(const Saved& saved) {
+    clear();
+    nowUs = saved.nowUs;
+    cursorTick = saved.cursorTick;
+    nextId = saved.nextId;
+    for (const auto& timer : saved.timers) insert(timer);
+}
+
+uint64_t Scheduler::remaining(TimerId id) const {
+    for (const auto& slot : slots) {
+        for (const auto& timer : slot) {
+            if (timer.id == id) return timer.due > nowUs ? timer.due - nowUs : 0;
+        }
+    }
+    return 0;
+}
+
+void Scheduler::insert(const Timer& timer) {
+    // Anything already overdue goes in the slot being visited now
+    uint64_t tick = std::max(timer.due / SLOT_US, cursorTick);
+    slots[tick % SLOT_COUNT].push_back(timer);
+    count++;
+}
+
+bool Scheduler::collectDue(size_t slot, std::vector<Timer>& out) {
+    out.clear();
+    auto& timers = slots[slot];
+    size_t kept = 0;
+    for (size_t i = 0; i < timers.size(); ++i) {
+        if (timers[i].due <= nowUs) out.push_back(timers[i]);
+        else timers[kept++] = timers[i]; // Due on a later revolution
+    }
+    timers.resize(kept);
+    count -= out.size();
+    std::sort(out.begin(), out.end(), [](const Timer& a, const Timer& b) {
+        return a.due != b.due ? a.due < b.due : a.id < b.id;
+    });
+    return !out.empty();
+}
+
+uint64_t Scheduler::earliestDueTick() const {
+    uint64_t first = UINT64_MAX;
+    for (const auto& slot : slots) {
+        for (const auto& timer : slot) first = std::min(first, timer.due / SLOT_US);
+    }
+    return first;
+}
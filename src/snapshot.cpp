@@ -0,0 +1,208 @@
+#include "snapshot.h"
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+const size_t SECTION_ALIGN = 8;
+const size_t TILE_TABLE_SIZE = (TRAIL_TILE_COUNT + 1) * sizeof(uint32_t);
+
+static_assert(sizeof(SnapshotHeader) % SECTION_ALIGN == 0 && sizeof(SnapshotGlobals) % SECTION_ALIGN == 0 &&
+              sizeof(SnapshotTimer) % SECTION_ALIGN == 0 && sizeof(SnapshotHead) * 2 % SECTION_ALIGN == 0,
+              "fixed sections keep the ones after them aligned");
+static_assert(sizeof(TrailPoint) == 12 && sizeof(Circle) == 20, "points and circles are stored as they are in memory");
+
+uint64_t aligned(uint64_t size) {
+    return (size + SECTION_ALIGN - 1) & ~static_cast<uint64_t>(SECTION_ALIGN - 1);
+}
+
+// Where each section starts, from the counts in the header. In 64 bits: the
+// counts are 32-bit, so nothing here wraps even where size_t is 32-bit, and a
+// reader compares size against the real buffer before using any offset.
+struct SnapshotLayout {
+    uint64_t heads, globals, timers, circles, tables[2], points[2], size;
+
+    SnapshotLayout(const SnapshotHeader& header) {
+        heads = sizeof(SnapshotHeader);
+        globals = heads + sizeof(SnapshotHead) * 2;
+        timers = globals + sizeof(SnapshotGlobals);
+        circles = timers + sizeof(SnapshotTimer) * static_cast<uint64_t>(header.timerCount);
+        uint64_t at = circles + aligned(sizeof(Circle) * static_cast<uint64_t>(header.circleCount));
+        for (int i = 0; i < 2; ++i) {
+            tables[i] = at;
+            points[i] = at + aligned(TILE_TABLE_SIZE);
+            at = points[i] + aligned(sizeof(TrailPoint) * static_cast<uint64_t>(header.pointCount[i]));
+        }
+        size = at;
+    }
+};
+
+void zeroPadding(uint8_t* from, uint8_t* to) {
+    if (to > from) std::memset(from, 0, to - from);
+}
+
+} // namespace
+
+uint64_t hashSnapshot(const uint8_t* data, size_t size) {
+    // FNV-1a a word at a time, in four lanes so the multiplies overlap
+    const uint64_t PRIME = 1099511628211ULL;
+    uint64_t lanes[4] = {1469598103934665603ULL, 1469598103934665603ULL ^ 1, 1469598103934665603ULL ^ 2, 1469598103934665603ULL ^ 3};
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        uint64_t words[4];
+        std::memcpy(words, data + i, 32);
+        for (int lane = 0; lane < 4; ++lane) lanes[lane] = (lanes[lane] ^ words[lane]) * PRIME;
+    }
+    uint64_t hash = lanes[0];
+    for (int lane = 1; lane < 4; ++lane) hash = (hash ^ lanes[lane]) * PRIME;
+    for (; i < size; ++i) hash = (hash ^ data[i]) * PRIME;
+    return hash;
+}
+
+void writeSnapshot(const GameState& state, std::vector<uint8_t>& out) {
+    SnapshotHeader header = {};
+    header.magic = SNAPSHOT_MAGIC;
+    header.version = SNAPSHOT_VERSION;
+    header.timerCount = static_cast<uint32_t>(state.scheduler.pending());
+    header.circleCount = static_cast<uint32_t>(state.circles.size());
+    for (int i = 0; i < 2; ++i) header.pointCount[i] = static_cast<uint32_t>(state.players[i].trail.size());
+    SnapshotLayout layout(header);
+    header.size = layout.size;
+    out.resize(static_cast<size_t>(layout.size)); // Only the fixed sections and padding are zeroed below; the rest is all copied over
+    uint8_t* base = out.data();
+
+    zeroPadding(base + layout.heads, base + layout.timers);
+    SnapshotHead* heads = reinterpret_cast<SnapshotHead*>(base + layout.heads);
+    for (int i = 0; i < 2; ++i) {
+        const Player& player = state.players[i];
+        Trail::Cursor cursor = player.trail.cursor();
+        SnapshotHead& head = heads[i];
+        head.pos = player.pos;
+        head.direction = player.direction;
+        head.color = player.color;
+        head.alive = player.alive;
+        head.willDie = player.willDie;
+        head.hasMoved = player.hasMoved;
+        head.killedBy = player.killedBy;
+        head.nextSeq = cursor.nextSeq;
+        head.newestPos = cursor.newestPos;
+        head.newestDirection = cursor.newestDirection;
+    }
+
+    Scheduler::Saved saved;
+    state.scheduler.save(saved);
+    SnapshotGlobals& globals = *reinterpret_cast<SnapshotGlobals*>(base + layout.globals);
+    globals.simTimeUs = state.simTimeUs;
+    globals.roundStartUs = state.roundStartUs;
+    std::memcpy(globals.rng, state.rng, sizeof(globals.rng));
+    globals.schedulerNowUs = saved.nowUs;
+    globals.schedulerCursorTick = saved.cursorTick;
+    globals.schedulerNextId = saved.nextId;
+    globals.spawnTimer = state.spawnTimer;
+    globals.countdownTimer = state.countdownTimer;
+    globals.scores[0] = state.scores[0];
+    globals.scores[1] = state.scores[1];
+    globals.countdown = state.countdown;
+    globals.gameOver = state.gameOver;
+    globals.collectible = state.collectible;
+
+    SnapshotTimer* timers = reinterpret_cast<SnapshotTimer*>(base + layout.timers);
+    for (size_t i = 0; i < saved.timers.size(); ++i) {
+        const Timer& timer = saved.timers[i];
+        timers[i] = SnapshotTimer{timer.id, timer.type, timer.arg, 0, timer.due, timer.interval};
+    }
+    size_t circleBytes = sizeof(Circle) * state.circles.size();
+    if (circleBytes) std::memcpy(base + layout.circles, state.circles.data(), circleBytes);
+    zeroPadding(base + layout.circles + circleBytes, base + layout.tables[0]);
+
+    for (int i = 0; i < 2; ++i) {
+        const Trail& trail = state.players[i].trail;
+        uint32_t* tileStart = reinterpret_cast<uint32_t*>(base + layout.tables[i]);
+        uint8_t* points = base + layout.points[i];
+        uint32_t at = 0;
+        for (int t = 0; t < TRAIL_TILE_COUNT; ++t) {
+            const auto& tile = trail.tile(t);
+            tileStart[t] = at;
+            if (!tile.empty()) std::memcpy(points + at * sizeof(TrailPoint), tile.data(), tile.size() * sizeof(TrailPoint));
+            at += static_cast<uint32_t>(tile.size());
+        }
+        tileStart[TRAIL_TILE_COUNT] = at;
+        zeroPadding(base + layout.tables[i] + TILE_TABLE_SIZE, points);
+        zeroPadding(points + at * sizeof(TrailPoint), base + (i == 0 ? layout.tables[1] : layout.size));
+    }
+
+    header.hash = hashSnapshot(base + sizeof(SnapshotHeader), layout.size - sizeof(SnapshotHeader));
+    std::memcpy(base, &header, sizeof(header));
+}
+
+bool SnapshotView::open(const uint8_t* data, size_t size, bool checkHash) {
+    header = nullptr;
+    if (reinterpret_cast<uintptr_t>(data) % SECTION_ALIGN != 0 || size < sizeof(SnapshotHeader)) return false;
+    const SnapshotHeader* candidate = reinterpret_cast<const SnapshotHeader*>(data);
+    if (candidate->magic != SNAPSHOT_MAGIC || candidate->version != SNAPSHOT_VERSION || candidate->size != size) return false;
+    SnapshotLayout layout(*candidate);
+    if (layout.size > SIZE_MAX || layout.size != size) return false; // Every offset is within size from here
+    if (checkHash && candidate->hash != hashSnapshot(data + sizeof(SnapshotHeader), size - sizeof(SnapshotHeader))) return false;
+    for (int i = 0; i < 2; ++i) {
+        const uint32_t* table = reinterpret_cast<const uint32_t*>(data + layout.tables[i]);
+        if (table[0] != 0 || table[TRAIL_TILE_COUNT] != candidate->pointCount[i]) return false;
+        for (int t = 0; t < TRAIL_TILE_COUNT; ++t) {
+            if (table[t] > table[t + 1]) return false;
+        }
+        tileStart[i] = table;
+        points[i] = reinterpret_cast<const TrailPoint*>(data + layout.points[i]);
+    }
+    heads = reinterpret_cast<const SnapshotHead*>(data + layout.heads);
+    global = reinterpret_cast<const SnapshotGlobals*>(data + layout.globals);
+    timerList = reinterpret_cast<const SnapshotTimer*>(data + layout.timers);
+    circleList = reinterpret_cast<const Circle*>(data + layout.circles);
+    header = candidate;
+    return true;
+}
+
+const TrailPoint* SnapshotView::tile(int player, int index, size_t& count) const {
+    count = tileStart[player][index + 1] - tileStart[player][index];
+    return points[player] + tileStart[player][index];
+}
+
+void SnapshotView::restore(GameState& state) const {
+    for (int i = 0; i < 2; ++i) {
+        Player& player = state.players[i];
+        const SnapshotHead& head = heads[i];
+        player.pos = head.pos;
+        player.direction = head.direction;
+        player.color = head.color;
+        player.alive = head.alive != 0;
+        player.willDie = head.willDie != 0;
+        player.hasMoved = head.hasMoved != 0;
+        player.killedBy = head.killedBy;
+        for (int t = 0; t < TRAIL_TILE_COUNT; ++t) {
+            size_t count;
+            const TrailPoint* tilePoints = tile(i, t, count);
+            player.trail.setTile(t, tilePoints, count);
+        }
+        player.trail.setCursor(Trail::Cursor{head.nextSeq, head.newestPos, head.newestDirection});
+    }
+    const SnapshotGlobals& globals = *global;
+    Scheduler::Saved saved;
+    saved.nowUs = globals.schedulerNowUs;
+    saved.cursorTick = globals.schedulerCursorTick;
+    saved.nextId = globals.schedulerNextId;
+    saved.timers.resize(header->timerCount);
+    for (size_t i = 0; i < saved.timers.size(); ++i) {
+        const SnapshotTimer& timer = timerList[i];
+        saved.timers[i] = Timer{timer.id, timer.type, timer.arg, timer.due, timer.interval};
+    }
+    state.scheduler.load(saved);
+    state.circles.assign(circleList, circleList + header->circleCount);
+    state.collectible = globals.collectible;
+    state.scores[0] = globals.scores[0];
+    state.scores[1] = globals.scores[1];
+    state.gameOver = globals.gameOver != 0;
+    state.countdown = globals.countdown;
+    std::memcpy(state.rng, globals.rng, sizeof(state.rng));
+    state.simTimeUs = globals.simTimeUs;
+    state.roundStartUs = globals.roundStartUs;
+    state.spawnTimer = globals.spawnTimer;
+    state.countdownTimer = globals.countdownTimer;
+}
@@ -0,0 +1,120 @@
+#include "softraster.h"
+#include "jobs.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+const size_t TILES_PER_TASK = 8;
+const uint32_t OPAQUE = 0xff000000;
+
+// Fills count pixels with one color, four per store where there is SIMD
+void fillSpan(uint32_t* dst, int count, uint32_t color) {
+    int i = 0;
+#if defined(__SSE2__)
+    __m128i value = _mm_set1_epi32(static_cast<int>(color));
+    for (; i + 4 <= count; i += 4) _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), value);
+#elif defined(__ARM_NEON)
+    uint32x4_t value = vdupq_n_u32(color);
+    for (; i + 4 <= count; i += 4) vst1q_u32(dst + i, value);
+#endif
+    for (; i < count; ++i) dst[i] = color;
+}
+
+// First pixel whose center (i + 0.5) is at or past edge
+int firstCenter(float edge) {
+    return static_cast<int>(std::ceil(edge - 0.5f));
+}
+
+} // namespace
+
+SoftRenderer::SoftRenderer() : framebuffer(WIDTH * HEIGHT, OPAQUE), bins(TILES_X * TILES_Y) {}
+
+void SoftRenderer::render(RenderList& list, JobSystem* jobs) {
+    list.sort();
+    for (auto& bin : bins) bin.clear();
+
+    // Bin every item into the tiles its bounds touch, in submission order
+    const std::vector<DrawItem>& items = list.itemList();
+    for (const DrawCommand& command : list.commandList()) {
+        DrawShape shape = keyShape(command.key);
+        uint32_t color = static_cast<uint32_t>(shape) << 24 | (command.key & 0xffffff);
+        for (uint32_t i = command.first; i < command.first + command.count; ++i) {
+            const DrawItem& item = items[i];
+            int x0, y0, x1, y1;
+            if (shape == SHAPE_SQUARE) {
+                x0 = firstCenter(item.x), x1 = firstCenter(item.x + item.size);
+                y0 = firstCenter(item.y), y1 = firstCenter(item.y + item.size);
+            } else {
+                x0 = firstCenter(item.x - item.size), x1 = firstCenter(item.x + item.size) + 1;
+                y0 = firstCenter(item.y - item.size), y1 = firstCenter(item.y + item.size) + 1;
+            }
+            x0 = std::max(x0, 0), y0 = std::max(y0, 0);
+            x1 = std::min(x1, WIDTH), y1 = std::min(y1, HEIGHT);
+            if (x0 >= x1 || y0 >= y1) continue;
+            for (int ty = y0 / TILE_SIZE; ty <= (y1 - 1) / TILE_SIZE; ++ty) {
+                for (int tx = x0 / TILE_SIZE; tx <= (x1 - 1) / TILE_SIZE; ++tx) bins[ty * TILES_X + tx].push_back(BinEntry{i, color});
+            }
+        }
+    }
+
+    if (!jobs) {
+        for (int t = 0; t < TILES_X * TILES_Y; ++t) rasterTile(list, t);
+        return;
+    }
+    jobs->parallelFor(TILES_X * TILES_Y, TILES_PER_TASK, [this, &list](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) rasterTile(list, static_cast<int>(t));
+    });
+}
+
+void SoftRenderer::rasterTile(const RenderList& list, int tile) {
+    int tileX0 = tile % TILES_X * TILE_SIZE, tileY0 = tile / TILES_X * TILE_SIZE;
+    int tileX1 = std::min(tileX0 + TILE_SIZE, WIDTH), tileY1 = std::min(tileY0 + TILE_SIZE, HEIGHT);
+    for (int y = tileY0; y < tileY1; ++y) fillSpan(&framebuffer[y * WIDTH + tileX0], tileX1 - tileX0, OPAQUE); // glClear
+
+    const std::vector<DrawItem>& items = list.itemList();
+    for (const BinEntry& entry : bins[tile]) {
+        const DrawItem& item = items[entry.item];
+        uint32_t color = OPAQUE | (entry.color & 0xffffff);
+        if (static_cast<DrawShape>(entry.color >> 24) == SHAPE_SQUARE) {
+            int x0 = std::max(firstCenter(item.x), tileX0), x1 = std::min(firstCenter(item.x + item.size), tileX1);
+            int y0 = std::max(firstCenter(item.y), tileY0), y1 = std::min(firstCenter(item.y + item.size), tileY1);
+            for (int y = y0; y < y1; ++y) fillSpan(&framebuffer[y * WIDTH + x0], x1 - x0, color);
+            continue;
+        }
+        // Circle: one span per row through the pixel centers
+        float radius2 = item.size * item.size;
+        int y0 = std::max(firstCenter(item.y - item.size), tileY0), y1 = std::min(firstCenter(item.y + item.size) + 1, tileY1);
+        for (int y = y0; y < y1; ++y) {
+            float dy = y + 0.5f - item.y;
+            float half2 = radius2 - dy * dy;
+            if (half2 <= 0) continue;
+            float half = std::sqrt(half2);
+            int x0 = std::max(firstCenter(item.x - half), tileX0), x1 = std::min(firstCenter(item.x + half), tileX1);
+            if (x0 < x1) fillSpan(&framebuffer[y * WIDTH + x0], x1 - x0, color);
+        }
+    }
+}
+
+bool SoftRenderer::writePpm(const std::string& path) const {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+    std::fprintf(file, "P6\n%d %d\n255\n", WIDTH, HEIGHT);
+    std::vector<uint8_t> row(WIDTH * 3);
+    for (int y = 0; y < HEIGHT; ++y) {
+        const uint32_t* src = &framebuffer[y * WIDTH];
+        for (int x = 0; x < WIDTH; ++x) {
+            row[x * 3] = src[x] >> 16 & 0xff;
+            row[x * 3 + 1] = src[x] >> 8 & 0xff;
+            row[x * 3 + 2] = src[x] & 0xff;
+        }
+        std::fwrite(row.data(), 1, row.size(), file);
+    }
+    return std::fclose(file) == 0;
+}
@@ -0,0 +1,311 @@
+#include "sweep.h"
+#include "bot.h"
+#include "game.h"
+#include "env.h"
+#include "observe.h"
+#include "policy.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <set>
+#include <sstream>
+#include <vector>
+#ifndef LINES_NO_THREADS
+#include <mutex>
+#include <thread>
+#endif
+
+namespace {
+
+struct SweepParam {
+    std::string key;
+    double min, max;
+    int steps;
+};
+
+struct SweepSpec {
+    bool random = false;
+    int samples = 100;
+    int matches = 8;
+    int rounds = 5;
+    uint32_t seed = 1;
+    int tickRate = 60;
+    float maxRoundSeconds = 180;
+    GameConfig base;
+    std::vector<SweepParam> params;
+    std::string policyPath;
+    Policy policy; // Loaded from policyPath after parsing; player 2 plays it
+};
+
+struct PointResult {
+    int rounds = 0;
+    int wins[2] = {0, 0};
+    int draws = 0; // Both players died on the same tick
+    int timeouts = 0; // Round hit MAX_ROUND_SECONDS
+    int collectibles = 0;
+    double roundSeconds = 0;
+    double circlesAtEnd = 0;
+    double trailPointsAtEnd = 0;
+    uint64_t ticks = 0;
+    double simSeconds = 0; // Wall time spent simulating
+};
+
+uint32_t hashText(const std::string& text) {
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (unsigned char c : text) hash = (hash ^ c) * 16777619u;
+    return hash;
+}
+
+bool parseSpec(const std::string& text, SweepSpec& spec) {
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line)) {
+        line = line.substr(0, line.find('#'));
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            if (line.find_first_not_of(" \t\r") != std::string::npos) {
+                std::fprintf(stderr, "sweep: bad line '%s'\n", line.c_str());
+                return false;
+            }
+            continue;
+        }
+        std::istringstream keyIn(line.substr(0, eq)), valueIn(line.substr(eq + 1));
+        std::string key, mode;
+        keyIn >> key;
+        if (key == "MODE") {
+            valueIn >> mode;
+            spec.random = mode == "random";
+            continue;
+        }
+        if (key == "POLICY") {
+            valueIn >> spec.policyPath;
+            continue;
+        }
+        std::vector<double> values;
+        double v, min, max;
+        while (valueIn >> v) values.push_back(v);
+        if (values.empty()) {
+            std::fprintf(stderr, "sweep: no value for %s\n", key.c_str());
+            return false;
+        }
+        if (key == "SAMPLES") spec.samples = static_cast<int>(values[0]);
+        else if (key == "MATCHES") spec.matches = static_cast<int>(values[0]);
+        else if (key == "ROUNDS") spec.rounds = static_cast<int>(values[0]);
+        else if (key == "SEED") spec.seed = static_cast<uint32_t>(values[0]);
+        else if (key == "TICK_RATE") spec.tickRate = static_cast<int>(values[0]);
+        else if (key == "MAX_ROUND_SECONDS") spec.maxRoundSeconds = static_cast<float>(values[0]);
+        else if (!configRange(key, min, max)) {
+            std::fprintf(stderr, "sweep: unknown key %s\n", key.c_str());
+            return false;
+        } else if (configInteger(key) && (values[0] != std::floor(values[0]) || (values.size() > 1 && values[1] != std::floor(values[1])))) {
+            std::fprintf(stderr, "sweep: %s takes whole numbers\n", key.c_str());
+            return false;
+        } else if (!setConfigValue(spec.base, key, values[0]) || (values.size() > 1 && !(values[1] >= min && values[1] <= max))) {
+            std::fprintf(stderr, "sweep: %s must stay within %g to %g\n", key.c_str(), min, max);
+            return false;
+        } else if (values.size() > 1) {
+            spec.params.push_back(SweepParam{key, values[0], values[1], values.size() > 2 ? std::max(2, static_cast<int>(values[2])) : 3});
+        }
+    }
+    return spec.matches > 0 && spec.rounds > 0 && spec.tickRate > 0;
+}
+
+// Integer keys play (and are written to the table) at the nearest whole
+// number, which setConfigValue accepts
+void roundIntegers(const SweepSpec& spec, std::vector<double>& point) {
+    for (size_t i = 0; i < spec.params.size(); ++i) {
+        if (configInteger(spec.params[i].key)) point[i] = std::round(point[i]);
+    }
+}
+
+// Every point is generated up front from the spec so indices are stable across resumes
+std::vector<std::vector<double>> makePoints(const SweepSpec& spec) {
+    std::vector<std::vector<double>> points;
+    if (spec.random) {
+        std::mt19937 rng(spec.seed);
+        for (int i = 0; i < spec.samples; ++i) {
+            std::vector<double> point;
+            for (const auto& p : spec.params) point.push_back(std::uniform_real_distribution<double>(p.min, p.max)(rng));
+            roundIntegers(spec, point);
+            points.push_back(point);
+        }
+        return points;
+    }
+    std::vector<int> index(spec.params.size(), 0);
+    while (true) {
+        std::vector<double> point;
+        for (size_t i = 0; i < spec.params.size(); ++i) {
+            const auto& p = spec.params[i];
+            point.push_back(p.min + (p.max - p.min) * index[i] / (p.steps - 1));
+        }
+        roundIntegers(spec, point);
+        points.push_back(point);
+        size_t i = 0;
+        while (i < index.size() && ++index[i] == spec.params[i].steps) index[i++] = 0;
+        if (i == index.size()) break;
+    }
+    return points;
+}
+
+PointResult runPoint(const SweepSpec& spec, const std::vector<double>& point, size_t pointIndex) {
+    GameConfig config = spec.base;
+    for (size_t i = 0; i < spec.params.size(); ++i) setConfigValue(config, spec.params[i].key, point[i]);
+
+    PointResult result;
+    CpuCollision collision;
+    GameState state;
+    float dt = 1.0f / spec.tickRate;
+    uint64_t maxRoundUs = secondsToUs(spec.maxRoundSeconds);
+    auto start = std::chrono::steady_clock::now();
+    for (int match = 0; match < spec.matches; ++match) {
+        newGame(state, config, hashText(std::to_string(spec.seed) + ":" + std::to_string(pointIndex) + ":" + std::to_string(match)));
+        Bot bots[2] = {Bot(0), Bot(1)};
+        std::unique_ptr<PolicyBot> policyBot;
+        if (!spec.policy.empty()) policyBot.reset(new PolicyBot(spec.policy, 1));
+        for (int round = 0; round < spec.rounds; ++round) {
+            uint64_t roundStart = state.simTimeUs;
+            bool over = false;
+            while (!over && state.simTimeUs - roundStart < maxRoundUs) {
+                PlayerInput inputs[2] = {bots[0].think(state, config), policyBot ? policyBot->think(state, config) : bots[1].think(state, config)};
+                int events = stepGame(state, config, inputs, dt, collision);
+                result.ticks++;
+                if (events & GAME_EVENT_COLLECTIBLE) result.collectibles++;
+                over = (events & GAME_EVENT_ROUND_OVER) != 0;
+            }
+            result.rounds++;
+            result.roundSeconds += (state.simTimeUs - roundStart) / 1e6;
+            result.circlesAtEnd += state.circles.size();
+            result.trailPointsAtEnd += state.players[0].trail.size() + state.players[1].trail.size();
+            bool alive1 = state.players[0].alive, alive2 = state.players[1].alive;
+            if (!over) result.timeouts++;
+            else if (alive1 && !alive2) result.wins[0]++;
+            else if (alive2 && !alive1) result.wins[1]++;
+            else result.draws++;
+
+            // Skip the score screen; nothing is simulated during it
+            state.scheduler.cancel(state.countdownTimer);
+            state.countdownTimer = INVALID_TIMER;
+            state.scheduler.cancel(state.spawnTimer);
+            resetRound(state, config);
+            bots[0].reset();
+            bots[1].reset();
+            if (policyBot) policyBot->reset();
+        }
+    }
+    result.simSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+std::string formatRow(size_t index, const std::vector<double>& point, const PointResult& r) {
+    std::ostringstream row;
+    row << index;
+    for (double v : point) row << '\t' << v;
+    double rounds = std::max(1, r.rounds);
+    row << '\t' << r.rounds << '\t' << r.wins[0] << '\t' << r.wins[1] << '\t' << r.draws << '\t' << r.timeouts
+        << '\t' << r.roundSeconds / rounds << '\t' << r.collectibles / rounds
+        << '\t' << r.circlesAtEnd / rounds << '\t' << r.trailPointsAtEnd / rounds
+        << '\t' << r.ticks << '\t' << (r.ticks ? r.simSeconds * 1e6 / r.ticks : 0) << '\n';
+    return row.str();
+}
+
+} // namespace
+
+int runSweep(const std::string& specPath, const std::string& outPath, int threads) {
+    std::ifstream specFile(specPath);
+    if (!specFile) {
+        std::fprintf(stderr, "sweep: cannot read %s\n", specPath.c_str());
+        return 1;
+    }
+    std::stringstream specText;
+    specText << specFile.rdbuf();
+    SweepSpec spec;
+    if (!parseSpec(specText.str(), spec)) return 1;
+    if (!spec.policyPath.empty()) {
+        if (!spec.policy.load(spec.policyPath)) {
+            std::fprintf(stderr, "sweep: cannot load policy %s\n", spec.policyPath.c_str());
+            return 1;
+        }
+        if (!PolicyBot::accepts(spec.policy)) {
+            std::fprintf(stderr, "sweep: policy %s takes %d inputs to %d outputs; bots need %d or %d inputs and 2 outputs\n", spec.policyPath.c_str(),
+                         spec.policy.inputs(), spec.policy.outputs(), ENV_OBS_SIZE, OBS_GRID_CELLS);
+            return 1;
+        }
+    }
+    std::vector<std::vector<double>> points = makePoints(spec);
+
+    // Resume: the first line ties the table to the spec it was produced from
+    char signature[64];
+    std::snprintf(signature, sizeof(signature), "# sweep %08x", hashText(specText.str()));
+    std::set<size_t> done;
+    bool fresh = true, partialLine = false;
+    {
+        std::ifstream existing(outPath, std::ios::binary);
+        std::string line;
+        if (existing && std::getline(existing, line)) {
+            if (line != signature) {
+                std::fprintf(stderr, "sweep: %s was produced by a different spec\n", outPath.c_str());
+                return 1;
+            }
+            fresh = false;
+            size_t columns = spec.params.size() + 12;
+            while (std::getline(existing, line)) {
+                partialLine = existing.eof(); // Last line had no newline: killed mid-write
+                if (line.empty() || line[0] == '#' || partialLine) continue;
+                if (static_cast<size_t>(std::count(line.begin(), line.end(), '\t')) + 1 == columns) {
+                    done.insert(std::strtoul(line.c_str(), nullptr, 10));
+                }
+            }
+        }
+    }
+    FILE* out = std::fopen(outPath.c_str(), "a");
+    if (!out) {
+        std::fprintf(stderr, "sweep: cannot write %s\n", outPath.c_str());
+        return 1;
+    }
+    if (partialLine) std::fputc('\n', out);
+    if (fresh) {
+        std::string header = std::string(signature) + "\n# point";
+        for (const auto& p : spec.params) header += "\t" + p.key;
+        header += "\trounds\tp1_wins\tp2_wins\tdraws\ttimeouts\tround_seconds\tcollectibles_per_round"
+                  "\tcircles_at_end\ttrail_points_at_end\tticks\tus_per_tick\n";
+        std::fputs(header.c_str(), out);
+        std::fflush(out);
+    }
+
+    std::vector<size_t> todo;
+    for (size_t i = 0; i < points.size(); ++i) if (!done.count(i)) todo.push_back(i);
+    std::fprintf(stderr, "sweep: %zu points, %zu already done\n", points.size(), points.size() - todo.size());
+
+    std::atomic<size_t> next(0);
+#ifndef LINES_NO_THREADS
+    std::mutex outMutex;
+#endif
+    auto work = [&]() {
+        size_t i;
+        while ((i = next++) < todo.size()) {
+            std::string row = formatRow(todo[i], points[todo[i]], runPoint(spec, points[todo[i]], todo[i]));
+#ifndef LINES_NO_THREADS
+            std::lock_guard<std::mutex> guard(outMutex);
+#endif
+            std::fputs(row.c_str(), out);
+            std::fflush(out); // Each finished point is a checkpoint
+        }
+    };
+#ifndef LINES_NO_THREADS
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t) workers.emplace_back(work);
+    work();
+    for (auto& worker : workers) worker.join();
+#else
+    (void)threads;
+    work();
+#endif
+    std::fclose(out);
+    return 0;
+}
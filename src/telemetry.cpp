@@ -0,0 +1,282 @@
+#include "telemetry.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#if defined(_WIN32)
+#include <io.h>
+#define LINES_WRITE _write
+#define LINES_CLOSE _close
+#else
+#include <unistd.h>
+#define LINES_WRITE ::write
+#define LINES_CLOSE ::close
+#endif
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#define LINES_UNIX_SOCKETS
+// A reader that goes away must not SIGPIPE the game: MSG_NOSIGNAL on Linux,
+// SO_NOSIGPIPE on macOS and the BSDs, or else SIGPIPE blocked in the writer
+#ifdef MSG_NOSIGNAL
+#define LINES_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define LINES_SEND_FLAGS 0
+#if !defined(SO_NOSIGPIPE) && !defined(LINES_NO_THREADS)
+#include <csignal>
+#include <pthread.h>
+#define LINES_BLOCK_SIGPIPE
+#endif
+#endif
+#endif
+
+namespace {
+
+const char* const UNIX_PREFIX = "unix:";
+const size_t MAX_BACKLOG = 1 << 20; // Bytes a slow socket reader may fall behind before batches are dropped
+const int CLOSE_DRAIN_MS = 200; // How long close() keeps trying to send the backlog
+
+#ifndef LINES_NO_THREADS
+
+const char* const HIT_NAMES[] = {"none", "blue", "red", "circle", "wall", "unknown"}; // By HitSource
+
+int formatRecord(const TelemetryRecord& r, char* out, size_t size) {
+    if (r.type == TELEMETRY_STUTTER) {
+        int n = std::snprintf(out, size, "{\"type\":\"stutter\",\"t\":%llu,\"frame_ms\":%.3f,\"zones\":{",
+            static_cast<unsigned long long>(r.timeUs), r.frameMs);
+        for (int z = 0; z < PROFILE_ZONE_COUNT && n > 0 && static_cast<size_t>(n) < size; ++z) {
+            n += std::snprintf(out + n, size - n, "%s\"%s\":%.3f", z ? "," : "", PROFILE_ZONE_NAMES[z], r.zoneMs[z]);
+        }
+        if (n > 0 && static_cast<size_t>(n) < size) {
+            n += std::snprintf(out + n, size - n, "},\"ivcsw\":%u,\"trail\":[%u,%u],\"circles\":%u}\n",
+                r.contextSwitches, r.trailPoints[0], r.trailPoints[1], r.circles);
+        }
+        return n;
+    }
+    if (r.type == TELEMETRY_HISTOGRAM) {
+        const float (*p)[4] = r.percentiles;
+        return std::snprintf(out, size,
+            "{\"type\":\"histogram\",\"t\":%llu,"
+            "\"frame_ms\":{\"p50\":%.3f,\"p99\":%.3f,\"p999\":%.3f,\"max\":%.3f},"
+            "\"tick_ms\":{\"p50\":%.3f,\"p99\":%.3f,\"p999\":%.3f,\"max\":%.3f}}\n",
+            static_cast<unsigned long long>(r.timeUs), p[0][0], p[0][1], p[0][2], p[0][3], p[1][0], p[1][1], p[1][2], p[1][3]);
+    }
+    if (r.type == TELEMETRY_ROUND) {
+        return std::snprintf(out, size,
+            "{\"type\":\"round\",\"t\":%llu,\"winner\":%d,\"scores\":[%d,%d],\"round_s\":%.3f,\"trail\":[%u,%u],\"circles\":%u,"
+            "\"killed_by\":[\"%s\",\"%s\"]}\n",
+            static_cast<unsigned long long>(r.timeUs), r.winner, r.scores[0], r.scores[1], r.roundSeconds,
+            r.trailPoints[0], r.trailPoints[1], r.circles, HIT_NAMES[r.killedBy[0]], HIT_NAMES[r.killedBy[1]]);
+    }
+    int n = std::snprintf(out, size,
+        "{\"type\":\"frame\",\"t\":%llu,\"frame_ms\":%.3f,\"tick_ms\":%.3f,\"ivcsw\":%u,\"trail\":[%u,%u],\"circles\":%u",
+        static_cast<unsigned long long>(r.timeUs), r.frameMs, r.tickMs, r.contextSwitches, r.trailPoints[0], r.trailPoints[1], r.circles);
+    for (int z = 0; r.gpu && z < GPU_ZONE_COUNT && n > 0 && static_cast<size_t>(n) < size; ++z) {
+        n += std::snprintf(out + n, size - n, "%s\"%s\":%.3f", z ? "," : ",\"gpu_ms\":{", GPU_ZONE_NAMES[z], r.gpuMs[z]);
+    }
+    if (r.gpu && n > 0 && static_cast<size_t>(n) < size) n += std::snprintf(out + n, size - n, "}");
+    if (r.gl && n > 0 && static_cast<size_t>(n) < size) {
+        const DrawStats& g = r.glStats;
+        n += std::snprintf(out + n, size - n, ",\"gl\":{\"draws\":%u,\"verts\":%u,\"states\":%u,\"redundant\":%u,\"up_bytes\":%u,\"read_bytes\":%u}",
+            g.drawCalls, g.vertices, g.stateChanges, g.redundantCalls, g.bytesUploaded, g.bytesRead);
+    }
+    if (n > 0 && static_cast<size_t>(n) < size) n += std::snprintf(out + n, size - n, "}\n");
+    return n;
+}
+#endif
+
+} // namespace
+
+Telemetry::Telemetry()
+    : queue(CAPACITY), droppedCount(0), running(false), opened(false), fd(-1) {}
+
+bool Telemetry::open(const std::string& path) {
+    close();
+#ifdef LINES_NO_THREADS
+    (void)path;
+    std::fprintf(stderr, "telemetry: not available without threads\n");
+    return false;
+#else
+    target = path;
+    if (!connectTarget()) {
+        std::fprintf(stderr, "telemetry: cannot open %s\n", path.c_str());
+        return false;
+    }
+    running = true;
+    opened = true;
+    writer = std::thread(&Telemetry::writerLoop, this);
+    return true;
+#endif
+}
+
+void Telemetry::close() {
+    if (!opened) return;
+    running = false;
+#ifndef LINES_NO_THREADS
+    writer.join();
+#endif
+    if (fd >= 0) LINES_CLOSE(fd);
+    fd = -1;
+    opened = false;
+}
+
+bool Telemetry::push(const TelemetryRecord& record) {
+    if (!opened) return false;
+    if (queue.push(record)) return true;
+    droppedCount.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool Telemetry::connectTarget() {
+    if (target.compare(0, strlen(UNIX_PREFIX), UNIX_PREFIX) == 0) {
+#ifdef LINES_UNIX_SOCKETS
+        std::string path = target.substr(strlen(UNIX_PREFIX));
+        sockaddr_un address;
+        if (path.size() >= sizeof(address.sun_path)) return false;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        memcpy(address.sun_path, path.c_str(), path.size());
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+#ifdef SO_NOSIGPIPE
+        int on = 1;
+        if (fd >= 0) setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        // Non-blocking, so a reader that stops reading cannot wedge the writer and with it close()
+        if (fd >= 0 && fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) == 0 &&
+            connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) return true;
+        if (fd >= 0) LINES_CLOSE(fd);
+        fd = -1;
+#endif
+        return false;
+    }
+    fd = ::open(target.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    return fd >= 0;
+}
+
+long Telemetry::writeSome(const char* data, size_t size) {
+    size_t total = 0;
+    while (total < size) {
+#ifdef LINES_UNIX_SOCKETS
+        long written = target.compare(0, strlen(UNIX_PREFIX), UNIX_PREFIX) == 0
+            ? static_cast<long>(send(fd, data + total, size - total, LINES_SEND_FLAGS))
+            : static_cast<long>(LINES_WRITE(fd, data + total, size - total));
+        if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break; // Reader is behind; the rest waits
+#else
+        long written = static_cast<long>(LINES_WRITE(fd, data + total, static_cast<unsigned>(size - total)));
+#endif
+        if (written <= 0) return -1;
+        total += written;
+    }
+    return static_cast<long>(total);
+}
+
+void Telemetry::writerLoop() {
+#ifndef LINES_NO_THREADS
+#ifdef LINES_BLOCK_SIGPIPE
+    sigset_t blocked;
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &blocked, nullptr); // SIGPIPE goes to the thread that wrote, so only this one needs it
+#endif
+    std::string backlog; // Formatted but not yet written; a line may be half sent
+    char line[512];
+    auto lastReconnect = std::chrono::steady_clock::now();
+    auto stopBy = lastReconnect;
+    bool stopping = false;
+    while (true) {
+        if (!stopping && !running.load()) {
+            stopping = true;
+            stopBy = std::chrono::steady_clock::now() + std::chrono::milliseconds(CLOSE_DRAIN_MS);
+        }
+        TelemetryRecord record;
+        uint64_t lost = 0;
+        while (queue.pop(record)) {
+            int size = formatRecord(record, line, sizeof(line));
+            if (size <= 0) continue;
+            if (backlog.size() < MAX_BACKLOG) backlog.append(line, std::min<size_t>(size, sizeof(line) - 1));
+            else lost++;
+        }
+        if (lost) droppedCount.fetch_add(lost, std::memory_order_relaxed);
+        if (!backlog.empty()) {
+            if (fd < 0) {
+                // Socket went away: drop until a reconnect succeeds, retrying once a second
+                auto now = std::chrono::steady_clock::now();
+                if (now - lastReconnect > std::chrono::seconds(1)) {
+                    lastReconnect = now;
+                    connectTarget();
+                }
+            }
+            long written = fd >= 0 ? writeSome(backlog.data(), backlog.size()) : -1;
+            if (written >= 0) {
+                backlog.erase(0, static_cast<size_t>(written));
+            } else {
+                if (fd >= 0) LINES_CLOSE(fd);
+                fd = -1;
+                backlog.clear(); // A new connection starts on a line boundary
+            }
+        }
+        if (stopping && (backlog.empty() || std::chrono::steady_clock::now() > stopBy)) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+#endif
+}
+
+void pushFrameTelemetry(Telemetry& telemetry, const GameState& state, const Profiler& profiler, bool stutter) {
+    if (!telemetry.isOpen()) return;
+    TelemetryRecord record{};
+    record.type = TELEMETRY_FRAME;
+    record.timeUs = state.simTimeUs;
+    record.frameMs = profiler.frameMs();
+    record.tickMs = profiler.zoneMs(ZONE_TICK);
+    record.contextSwitches = profiler.contextSwitches();
+    record.gpu = profiler.hasGpu();
+    for (int z = 0; z < GPU_ZONE_COUNT; ++z) record.gpuMs[z] = profiler.gpuZoneMs(static_cast<GpuZone>(z));
+    record.gl = profiler.hasDrawStats();
+    record.glStats = profiler.drawStats();
+    record.trailPoints[0] = state.players[0].trail.size();
+    record.trailPoints[1] = state.players[1].trail.size();
+    record.circles = state.circles.size();
+    telemetry.push(record);
+    if (stutter) {
+        const StutterSnapshot& snapshot = profiler.lastStutter();
+        record.type = TELEMETRY_STUTTER;
+        record.frameMs = snapshot.frameMs;
+        record.contextSwitches = snapshot.contextSwitches;
+        std::copy(snapshot.zoneMs, snapshot.zoneMs + PROFILE_ZONE_COUNT, record.zoneMs);
+        telemetry.push(record);
+    }
+}
+
+void pushRoundTelemetry(Telemetry& telemetry, const GameState& state) {
+    if (!telemetry.isOpen()) return;
+    TelemetryRecord record{};
+    bool alive1 = state.players[0].alive, alive2 = state.players[1].alive;
+    record.type = TELEMETRY_ROUND;
+    record.winner = alive1 == alive2 ? -1 : alive1 ? 0 : 1;
+    for (int i = 0; i < 2; ++i) record.killedBy[i] = static_cast<int8_t>(state.players[i].killedBy);
+    record.timeUs = state.simTimeUs;
+    record.roundSeconds = (state.simTimeUs - state.roundStartUs) / 1e6f;
+    record.trailPoints[0] = state.players[0].trail.size();
+    record.trailPoints[1] = state.players[1].trail.size();
+    record.circles = state.circles.size();
+    record.scores[0] = state.scores[0];
+    record.scores[1] = state.scores[1];
+    telemetry.push(record);
+}
+
+void pushHistogramTelemetry(Telemetry& telemetry, const GameState& state, const Profiler& profiler) {
+    if (!telemetry.isOpen()) return;
+    TelemetryRecord record{};
+    record.type = TELEMETRY_HISTOGRAM;
+    record.timeUs = state.simTimeUs;
+    const Histogram* histograms[] = {&profiler.frameHistogram(), &profiler.tickHistogram()};
+    for (int i = 0; i < 2; ++i) {
+        record.percentiles[i][0] = histograms[i]->percentile(50) / 1000.0f;
+        record.percentiles[i][1] = histograms[i]->percentile(99) / 1000.0f;
+        record.percentiles[i][2] = histograms[i]->percentile(99.9) / 1000.0f;
+        record.percentiles[i][3] = histograms[i]->max() / 1000.0f;
+    }
+    telemetry.push(record);
+}
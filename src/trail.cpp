@@ -0,0 +1,63 @@
+#include "game.h"
+#include <cmath>
+
+void Trail::push(const Vec2& pos) {
+    int index = tileY(pos.y) * TRAIL_TILES_X + tileX(pos.x);
+    tiles[index].push_back(TrailPoint{pos, nextSeq++});
+    dirtyTiles[index] = 1;
+    newestPos = pos;
+}
+
+namespace {
+
+const float TURN_COS = std::cos(TRAIL_TURN);
+
+} // namespace
+
+bool Trail::sample(const Vec2& pos, const Vec2& direction) {
+    float dx = pos.x - newestPos.x, dy = pos.y - newestPos.y;
+    float moved = dx * dx + dy * dy;
+    bool turned = direction.x * newestDirection.x + direction.y * newestDirection.y < TURN_COS;
+    if (nextSeq > 0 && moved < TRAIL_SPACING * TRAIL_SPACING && !(turned && moved >= TRAIL_SPACING * TRAIL_SPACING / 4)) return false;
+    push(pos);
+    newestDirection = direction;
+    return true;
+}
+
+void Trail::clear() {
+    for (auto& points : tiles) points.clear(); // Keeps capacity for the next round
+    nextSeq = 0;
+    markAllDirty();
+}
+
+void Trail::setTile(int index, const TrailPoint* points, size_t count) {
+    tiles[index].assign(points, points + count);
+    dirtyTiles[index] = 1;
+}
+
+void Trail::place(const TrailPoint& point) {
+    int index = tileY(point.pos.y) * TRAIL_TILES_X + tileX(point.pos.x);
+    tiles[index].push_back(point);
+    dirtyTiles[index] = 1;
+}
+
+void Trail::setCursor(const Cursor& cursor) {
+    nextSeq = cursor.nextSeq;
+    newestPos = cursor.newestPos;
+    newestDirection = cursor.newestDirection;
+}
+
+size_t Trail::size() const {
+    size_t count = 0;
+    for (const auto& points : tiles) count += points.size();
+    return count;
+}
+
+int Trail::tileX(float x) {
+    // The last point of a player leaving the arena lands outside it
+    return std::max(0, std::min(TRAIL_TILES_X - 1, static_cast<int>(std::floor(x / TRAIL_TILE_SIZE))));
+}
+
+int Trail::tileY(float y) {
+    return std::max(0, std::min(TRAIL_TILES_Y - 1, static_cast<int>(std::floor(y / TRAIL_TILE_SIZE))));
+}